@@ -15,6 +15,10 @@
 #define AI_REGS_BASE_ADDRESS      0x04500000
 #define AI_REGS_ADDRESS_LEN       0x00000018
 
+/* Cartridge SRAM (Domain 2). */
+#define CART_SRAM_BASE_ADDRESS    0x08000000
+#define CART_SRAM_ADDRESS_LEN     0x08000000
+
 /* Display Processor Registers. */
 #define DP_REGS_BASE_ADDRESS      0x04100000
 #define DP_REGS_ADDRESS_LEN       0x00000020
@@ -75,5 +79,11 @@
 #define VI_REGS_BASE_ADDRESS      0x04400000
 #define VI_REGS_ADDRESS_LEN       0x00000038
 
+/* VR4300 Unmapped Segments (KSEG0/KSEG1). */
+#define KSEG0_BASE_ADDRESS        0xFFFFFFFF80000000ULL
+#define KSEG1_BASE_ADDRESS        0xFFFFFFFFA0000000ULL
+#define KSEG_ADDRESS_LEN          0x20000000
+#define KSEG_ADDRESS_MASK         0x1FFFFFFF
+
 #endif
 
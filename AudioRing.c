@@ -0,0 +1,198 @@
+/* ============================================================================
+ *  AudioRing.c: Lock-free AI sample ring for host audio consumers.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "AudioRing.h"
+#include "Common.h"
+#include "Controller.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+static void SwapSamples(uint8_t *, size_t);
+
+/* ============================================================================
+ *  BusAudioRingFill: Returns the number of bytes waiting for the consumer.
+ *
+ *  This is the backpressure signal: pacing code on the emulation thread can
+ *  throttle when it climbs and speed up as it drains.
+ * ========================================================================= */
+size_t
+BusAudioRingFill(const struct BusController *bus) {
+  struct AudioRing *ring = bus->audioRing;
+
+  if (ring == NULL)
+    return 0;
+
+  return atomic_read(&ring->head) - atomic_read(&ring->tail);
+}
+
+/* ============================================================================
+ *  BusAudioRingRead: Consumer side; copies out up to `size` bytes.
+ * ========================================================================= */
+size_t
+BusAudioRingRead(struct BusController *bus, void *dest, size_t size) {
+  struct AudioRing *ring = bus->audioRing;
+  size_t available, chunk, copied, offset, tail;
+
+  if (ring == NULL)
+    return 0;
+
+  /* Never split a sample. */
+  size &= ~(size_t) 1;
+  tail = ring->tail;
+  available = atomic_read(&ring->head) - tail;
+
+  if (size > available) {
+    atomic_write(&ring->underrunBytes,
+      ring->underrunBytes + (size - available));
+    size = available;
+  }
+
+  for (copied = 0; copied < size; copied += chunk) {
+    offset = (tail + copied) & ring->mask;
+    chunk = ring->mask + 1 - offset;
+
+    if (chunk > size - copied)
+      chunk = size - copied;
+
+    memcpy((uint8_t*) dest + copied, ring->data + offset, chunk);
+  }
+
+  atomic_write(&ring->tail, tail + size);
+  return size;
+}
+
+/* ============================================================================
+ *  BusDisableAudioRing: Releases the ring. The consumer must be stopped.
+ * ========================================================================= */
+void
+BusDisableAudioRing(struct BusController *bus) {
+  struct AudioRing *ring = bus->audioRing;
+
+  if (ring == NULL)
+    return;
+
+  debugarg("Audio ring overran by %lu bytes.",
+    (unsigned long) atomic_read(&ring->overrunBytes));
+
+  bus->audioRing = NULL;
+  free(ring->data);
+  free(ring);
+}
+
+/* ============================================================================
+ *  BusEnableAudioRing: Allocates a ring of (at least) `capacity` bytes.
+ * ========================================================================= */
+int
+BusEnableAudioRing(struct BusController *bus, size_t capacity) {
+  struct AudioRing *ring;
+  size_t size = 4096;
+
+  if (bus->audioRing != NULL)
+    return 0;
+
+  while (size < capacity)
+    size <<= 1;
+
+  if ((ring = (struct AudioRing*) calloc(1, sizeof(*ring))) == NULL) {
+    debug("Failed to allocate memory.");
+    return 1;
+  }
+
+  if ((ring->data = (uint8_t*) malloc(size)) == NULL) {
+    debug("Failed to allocate memory.");
+    free(ring);
+    return 1;
+  }
+
+  ring->mask = size - 1;
+  bus->audioRing = ring;
+  return 0;
+}
+
+/* ============================================================================
+ *  BusGetAudioRingStats: Returns the bytes dropped on either side.
+ * ========================================================================= */
+void
+BusGetAudioRingStats(const struct BusController *bus,
+  uint64_t *overrunBytes, uint64_t *underrunBytes) {
+  struct AudioRing *ring = bus->audioRing;
+
+  *overrunBytes = ring != NULL ? atomic_read(&ring->overrunBytes) : 0;
+  *underrunBytes = ring != NULL ? atomic_read(&ring->underrunBytes) : 0;
+}
+
+/* ============================================================================
+ *  DMAToAudioRing: Producer side; moves AI samples from RDRAM to the ring.
+ *
+ *  Samples are DMA'd straight into the ring and swapped in place, so there
+ *  is no intermediate buffer. If the consumer has fallen behind, whatever
+ *  doesn't fit is dropped (and counted) rather than blocking the AI.
+ * ========================================================================= */
+size_t
+DMAToAudioRing(struct BusController *bus, uint32_t source, size_t size) {
+  struct AudioRing *ring = bus->audioRing;
+  size_t chunk, copied, head, offset, space;
+
+  if (ring == NULL)
+    return 0;
+
+  size &= ~(size_t) 1;
+  head = ring->head;
+  space = ring->mask + 1 - (head - atomic_read(&ring->tail));
+
+  if (size > space) {
+    atomic_write(&ring->overrunBytes,
+      ring->overrunBytes + (size - space));
+    size = space;
+  }
+
+  for (copied = 0; copied < size; copied += chunk) {
+    offset = (head + copied) & ring->mask;
+    chunk = ring->mask + 1 - offset;
+
+    if (chunk > size - copied)
+      chunk = size - copied;
+
+    DMAFromDRAM(bus, ring->data + offset, source + copied, chunk);
+    SwapSamples(ring->data + offset, chunk);
+  }
+
+  atomic_write(&ring->head, head + size);
+  return size;
+}
+
+/* ============================================================================
+ *  SwapSamples: Converts big-endian 16-bit samples to host byte order.
+ * ========================================================================= */
+static void
+SwapSamples(uint8_t *samples, size_t size) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  (void) samples;
+  (void) size;
+#else
+  uint8_t temp;
+  size_t i;
+
+  for (i = 0; i < size; i += 2) {
+    temp = samples[i];
+    samples[i] = samples[i + 1];
+    samples[i + 1] = temp;
+  }
+#endif
+}
+
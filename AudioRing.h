@@ -0,0 +1,55 @@
+/* ============================================================================
+ *  AudioRing.h: Lock-free AI sample ring for host audio consumers.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__AUDIORING_H__
+#define __BUS__AUDIORING_H__
+#include "Common.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#else
+#include <stddef.h>
+#endif
+
+#define AUDIO_RING_LINE_SIZE 64
+
+struct BusController;
+
+/* Single producer (AI), single consumer (host). Indices never wrap; */
+/* they're masked on use, so head - tail is always the fill level. */
+struct AudioRing {
+  /* Read by both threads; never written after setup. */
+  uint8_t *data;
+  size_t mask;
+  uint8_t configPad[AUDIO_RING_LINE_SIZE];
+
+  /* Written only by the emulation thread. */
+  size_t head;
+  uint64_t overrunBytes;
+  uint8_t producerPad[AUDIO_RING_LINE_SIZE];
+
+  /* Written only by the consumer thread. */
+  size_t tail;
+  uint64_t underrunBytes;
+  uint8_t consumerPad[AUDIO_RING_LINE_SIZE];
+};
+
+int BusEnableAudioRing(struct BusController *, size_t);
+void BusDisableAudioRing(struct BusController *);
+
+size_t BusAudioRingFill(const struct BusController *);
+size_t BusAudioRingRead(struct BusController *, void *, size_t);
+void BusGetAudioRingStats(const struct BusController *,
+  uint64_t *, uint64_t *);
+
+size_t DMAToAudioRing(struct BusController *, uint32_t, size_t);
+
+#endif
+
@@ -78,6 +78,16 @@ typedef char bool;
 #define unlikely(expr)
 #endif
 
+/* ============================================================================
+ *  atomic_*(ptr): Sequentially consistent operations for host-shared data.
+ * ========================================================================= */
+#ifdef __GNUC__
+#define atomic_read(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define atomic_write(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST)
+#define atomic_inc(ptr) __atomic_add_fetch(ptr, 1, __ATOMIC_SEQ_CST)
+#define atomic_dec(ptr) __atomic_sub_fetch(ptr, 1, __ATOMIC_SEQ_CST)
+#endif
+
 /* ============================================================================
  *  unused(x): Marks unused variables.
  * ========================================================================= */
@@ -8,10 +8,18 @@
  *  This file is subject to the terms and conditions defined in
  *  file 'LICENSE', which is part of this source code package.
  * ========================================================================= */
+#include "AudioRing.h"
 #include "Common.h"
 #include "Controller.h"
+#include "DMAEngine.h"
+#include "DecoderProfile.h"
 #include "Externs.h"
+#include "FrameExport.h"
 #include "MemoryMap.h"
+#include "OpenBus.h"
+#include "Telemetry.h"
+#include "Watchpoint.h"
+#include "WriteBuffer.h"
 
 #ifdef __cplusplus
 #include <cstddef>
@@ -23,17 +31,51 @@
 #include <string.h>
 #endif
 
+/* MI registers that the bus answers for itself. */
+enum MIRegister {
+  MI_MODE_REG = 0,
+  MI_INTR_REG = 2,
+  MI_INTR_MASK_REG = 3
+};
+
+#define MI_INTR_DP 0x20
+#define MI_INTR_MASK_SET_ALL 0xAAA
+#define MI_MODE_CLEAR_DP_INTR 0x800
+
 static int InitBus(
   struct BusController *, struct AIFController *, struct PIFController *,
   struct RDRAMController *, struct ROMController *, struct VIFController *,
   struct RDP *, struct RSP *, struct VR4300 *);
 
+static void BeginAccess(const struct BusController *, uint32_t);
+static void CountMappedAccess(const struct BusController *,
+  unsigned, const struct MemoryMapping *);
+static void CountUnmappedAccess(const struct BusController *, uint32_t);
+static const struct MemoryMapping *DecodeAddress(
+  const struct BusController *, unsigned, uint32_t);
+static int TranslateVirtualAddress(
+  const struct BusController *, uint64_t, uint32_t *);
+
 /* ============================================================================
  *  BusClearRCPInterrupt: Clears an RCP interrupt flag.
  * ========================================================================= */
 void
 BusClearRCPInterrupt(struct BusController *bus, unsigned mask) {
-  VR4300ClearRCPInterrupt(bus->vr4300, mask);
+  if (bus->telemetry != NULL)
+    bus->telemetry->counters.interruptsCleared++;
+
+  bus->rcpIntrPending &= ~mask;
+
+  if (!bus->coalesceInterrupts)
+    BusUpdateRCPInterrupt(bus);
+}
+
+/* ============================================================================
+ *  BusGetRCPInterruptPending: Returns the pending (unmasked) RCP interrupts.
+ * ========================================================================= */
+unsigned
+BusGetRCPInterruptPending(const struct BusController *bus) {
+  return bus->rcpIntrPending;
 }
 
 /* ============================================================================
@@ -41,15 +83,136 @@ BusClearRCPInterrupt(struct BusController *bus, unsigned mask) {
  * ========================================================================= */
 const uint8_t *
 BusGetRDRAMPointer(const struct BusController *bus) {
+  if (bus->writeBuffer != NULL)
+    FlushWriteBuffer(bus->writeBuffer);
+
   return GetRDRAMMemoryPointer(bus->rdram);
 }
 
+/* ============================================================================
+ *  BusMIRegRead: Reads an MI register, answering for the interrupt state.
+ *
+ *  MI_INTR and MI_INTR_MASK live in the bus (so that the VR4300 only ever
+ *  hears about effective changes); everything else belongs to the VR4300.
+ * ========================================================================= */
+int
+BusMIRegRead(void *opaque, uint32_t address, void *data) {
+  struct BusController *bus = (struct BusController*) opaque;
+  uint32_t word;
+
+  switch ((address - MI_REGS_BASE_ADDRESS) >> 2) {
+    case MI_INTR_REG: word = bus->rcpIntrPending; break;
+    case MI_INTR_MASK_REG: word = bus->rcpIntrMask; break;
+    default: return MIRegRead(bus->vr4300, address, data);
+  }
+
+  memcpy(data, &word, sizeof(word));
+  return 0;
+}
+
+/* ============================================================================
+ *  BusMIRegWrite: Writes an MI register, keeping interrupt state on the bus.
+ *
+ *  MI_INTR_MASK takes a clear/set bit pair per interrupt. MI_MODE can also
+ *  clear the DP interrupt; that bit is peeled off and handled here, so the
+ *  VR4300 never changes its pending interrupts behind the bus's back.
+ * ========================================================================= */
+int
+BusMIRegWrite(void *opaque, uint32_t address, void *data) {
+  struct BusController *bus = (struct BusController*) opaque;
+  unsigned i, mask;
+  uint32_t word;
+
+  memcpy(&word, data, sizeof(word));
+
+  switch ((address - MI_REGS_BASE_ADDRESS) >> 2) {
+    case MI_MODE_REG:
+      if (word & MI_MODE_CLEAR_DP_INTR) {
+        BusClearRCPInterrupt(bus, MI_INTR_DP);
+        word &= ~MI_MODE_CLEAR_DP_INTR;
+      }
+
+      return MIRegWrite(bus->vr4300, address, &word);
+
+    case MI_INTR_MASK_REG:
+      for (mask = bus->rcpIntrMask, i = 0; i < 6; i++) {
+        if (word & (1U << (i << 1)))
+          mask &= ~(1U << i);
+
+        if (word & (2U << (i << 1)))
+          mask |= 1U << i;
+      }
+
+      BusSetRCPInterruptMask(bus, mask);
+      return 0;
+
+    case MI_INTR_REG:
+      return 0;
+
+    default:
+      return MIRegWrite(bus->vr4300, address, data);
+  }
+}
+
 /* ============================================================================
  *  BusRaiseRCPInterrupt: Sets an RCP interrupt flag.
  * ========================================================================= */
 void
 BusRaiseRCPInterrupt(struct BusController *bus, unsigned mask) {
-  VR4300RaiseRCPInterrupt(bus->vr4300, mask);
+  if (bus->telemetry != NULL)
+    bus->telemetry->counters.interruptsRaised++;
+
+  bus->rcpIntrPending |= mask;
+
+  if (!bus->coalesceInterrupts)
+    BusUpdateRCPInterrupt(bus);
+}
+
+/* ============================================================================
+ *  BusSetInterruptCoalescing: Defers delivery to BusCheckRCPInterrupt.
+ *
+ *  Once enabled, raises and clears only update the pending word; the CPU
+ *  core is expected to call BusCheckRCPInterrupt at instruction boundaries.
+ * ========================================================================= */
+void
+BusSetInterruptCoalescing(struct BusController *bus, bool enable) {
+  bus->coalesceInterrupts = enable;
+
+  if (!enable)
+    BusUpdateRCPInterrupt(bus);
+}
+
+/* ============================================================================
+ *  BusSetRCPInterruptMask: Sets which RCP interrupts reach the VR4300.
+ * ========================================================================= */
+void
+BusSetRCPInterruptMask(struct BusController *bus, unsigned mask) {
+  bus->rcpIntrMask = mask & RCP_INTERRUPT_MASK;
+
+  if (!bus->coalesceInterrupts)
+    BusUpdateRCPInterrupt(bus);
+}
+
+/* ============================================================================
+ *  BusUpdateRCPInterrupt: Tells the VR4300 what changed since last time.
+ *
+ *  Nothing is sent unless (pending & mask) differs from what the VR4300
+ *  last saw, so back-to-back raise/clear pairs and masked interrupts never
+ *  make it re-evaluate its interrupt state.
+ * ========================================================================= */
+void
+BusUpdateRCPInterrupt(struct BusController *bus) {
+  unsigned effective = bus->rcpIntrPending & bus->rcpIntrMask;
+  unsigned raised = effective & ~bus->rcpIntrNotified;
+  unsigned cleared = bus->rcpIntrNotified & ~effective;
+
+  bus->rcpIntrNotified = effective;
+
+  if (cleared)
+    VR4300ClearRCPInterrupt(bus->vr4300, cleared);
+
+  if (raised)
+    VR4300RaiseRCPInterrupt(bus->vr4300, raised);
 }
 
 /* ============================================================================
@@ -84,9 +247,19 @@ void
 DestroyBus(struct BusController *controller) {
   unsigned i;
 
+  BusClearWatchpoints(controller);
+  BusDisableDMAWorkers(controller);
+  BusDisableTelemetry(controller);
+  BusDetachSaveMemory(controller);
+  BusDisableAudioRing(controller);
+  BusDisableFrameExport(controller);
+  BusDisableWriteCombining(controller);
+
   for (i = 0; i < 5; i++)
     DestroyMemoryMap(controller->memoryMaps[i]);
 
+  DestroyOpenBus(controller->openBus);
+  free(controller->decoderProfile);
   free(controller);
 }
 
@@ -98,6 +271,7 @@ InitBus(struct BusController *controller, struct AIFController *aif,
   struct PIFController *pif, struct RDRAMController *rdram,
   struct ROMController *rom, struct VIFController *vif,
   struct RDP *rdp, struct RSP *rsp, struct VR4300 *vr4300) {
+  uint32_t openMask = MI_INTR_MASK_SET_ALL;
 
   debug("Initializing Bus.");
   memset(controller, 0, sizeof(*controller));
@@ -133,7 +307,7 @@ InitBus(struct BusController *controller, struct AIFController *aif,
     rdram, RDRAMReadHWord, RDRAMWriteHWord);
 
   /* Round up all the word-addressable read/write functions. */
-  if ((controller->memoryMaps[2] = CreateMemoryMap(16)) == NULL) {
+  if ((controller->memoryMaps[2] = CreateMemoryMap(17)) == NULL) {
     DestroyMemoryMap(controller->memoryMaps[0]);
     DestroyMemoryMap(controller->memoryMaps[1]);
     return 1;
@@ -143,13 +317,17 @@ InitBus(struct BusController *controller, struct AIFController *aif,
     AI_REGS_BASE_ADDRESS, AI_REGS_ADDRESS_LEN,
     aif, AIRegRead, AIRegWrite);
 
+  MapAddressRange(controller->memoryMaps[2],
+    CART_SRAM_BASE_ADDRESS, CART_SRAM_ADDRESS_LEN,
+    &controller->saveMemory, SaveMemoryRead, SaveMemoryWrite);
+
   MapAddressRange(controller->memoryMaps[2],
     DP_REGS_BASE_ADDRESS, DP_REGS_ADDRESS_LEN,
     rdp, DPRegRead, DPRegWrite);
 
   MapAddressRange(controller->memoryMaps[2],
     MI_REGS_BASE_ADDRESS, MI_REGS_ADDRESS_LEN,
-    vr4300, MIRegRead, MIRegWrite);
+    controller, BusMIRegRead, BusMIRegWrite);
 
   MapAddressRange(controller->memoryMaps[2],
     PIF_RAM_BASE_ADDRESS, PIF_RAM_ADDRESS_LEN,
@@ -211,6 +389,7 @@ InitBus(struct BusController *controller, struct AIFController *aif,
     return 1;
   }
 
+  /* Unaligned stores only; nothing is ever read through this map. */
   MapAddressRange(controller->memoryMaps[3],
     RDRAM_BASE_ADDRESS, RDRAM_ADDRESS_LEN,
     rdram, NULL, RDRAMWriteWordUnaligned);
@@ -229,6 +408,16 @@ InitBus(struct BusController *controller, struct AIFController *aif,
     RDRAM_BASE_ADDRESS, RDRAM_ADDRESS_LEN,
     rdram, RDRAMReadDWord, RDRAMWriteDWord);
 
+  /* Anything that doesn't decode lands here. */
+  if ((controller->openBus = CreateOpenBus()) == NULL) {
+    DestroyMemoryMap(controller->memoryMaps[0]);
+    DestroyMemoryMap(controller->memoryMaps[1]);
+    DestroyMemoryMap(controller->memoryMaps[2]);
+    DestroyMemoryMap(controller->memoryMaps[3]);
+    DestroyMemoryMap(controller->memoryMaps[4]);
+    return 1;
+  }
+
   controller->aif = aif;
   controller->pif = pif;
   controller->rdram = rdram;
@@ -254,6 +443,9 @@ InitBus(struct BusController *controller, struct AIFController *aif,
   ConnectRDPtoRSP(rsp, rdp);
   ConnectVR4300ToBus(vr4300, controller);
 
+  /* The bus does the masking; leave the VR4300's own mask wide open. */
+  MIRegWrite(vr4300,
+    MI_REGS_BASE_ADDRESS + (MI_INTR_MASK_REG << 2), &openMask);
   return 0;
 }
 
@@ -262,6 +454,12 @@ InitBus(struct BusController *controller, struct AIFController *aif,
  * ========================================================================= */
 void DMAFromDRAM(struct BusController *bus,
   void *dest, uint32_t source, uint32_t size) {
+  if (bus->writeBuffer != NULL)
+    FlushWriteBuffer(bus->writeBuffer);
+
+  if (bus->telemetry != NULL)
+    bus->telemetry->counters.dmaBytes += size;
+
   CopyFromDRAM(bus->rdram, dest, source, size);
 }
 
@@ -270,6 +468,12 @@ void DMAFromDRAM(struct BusController *bus,
  * ========================================================================= */
 void DMAToDRAM(struct BusController *bus,
   uint32_t dest, const void *source, size_t size) {
+  if (bus->writeBuffer != NULL)
+    FlushWriteBuffer(bus->writeBuffer);
+
+  if (bus->telemetry != NULL)
+    bus->telemetry->counters.dmaBytes += size;
+
   CopyToDRAM(bus->rdram, dest, source, size);
 }
 
@@ -278,15 +482,49 @@ void DMAToDRAM(struct BusController *bus,
  * ========================================================================= */
 MemoryFunction BusRead(const struct BusController *bus,
   unsigned type, uint32_t address, void **opaque) {
-  const struct MemoryMap *memoryMap = bus->memoryMaps[type];
+  unsigned cycles;
+
+  return BusReadTimed(bus, type, address, opaque, &cycles);
+}
+
+/* ============================================================================
+ *  BusReadTimed: Like BusRead, but also returns the cost of the access.
+ * ========================================================================= */
+MemoryFunction BusReadTimed(const struct BusController *bus,
+  unsigned type, uint32_t address, void **opaque, unsigned *cycles) {
+  const struct MemoryMapping *mapping = DecodeAddress(bus, type, address);
+
+  *cycles = mapping->cycles + mapping->contention;
+  memcpy(opaque, &mapping->readInstance, sizeof(mapping->readInstance));
+  return mapping->onRead;
+}
+
+/* ============================================================================
+ *  BusReadVirtual: Reads a variable amount of data using a virtual address.
+ * ========================================================================= */
+MemoryFunction BusReadVirtual(const struct BusController *bus,
+  unsigned type, uint64_t vaddr, void **opaque, uint32_t *address) {
+  unsigned cycles;
+
+  return BusReadVirtualTimed(bus, type, vaddr, opaque, address, &cycles);
+}
+
+/* ============================================================================
+ *  BusReadVirtualTimed: Like BusReadVirtual, but also returns the cost.
+ * ========================================================================= */
+MemoryFunction BusReadVirtualTimed(const struct BusController *bus,
+  unsigned type, uint64_t vaddr, void **opaque, uint32_t *address,
+  unsigned *cycles) {
   const struct MemoryMapping *mapping;
 
-  if ((mapping = ResolveMappedAddress(memoryMap, address)) == NULL) {
-    debugarg("Read from unmapped address [0x%.8X].", address);
+  if (TranslateVirtualAddress(bus, vaddr, address)) {
+    *cycles = 0;
     return NULL;
   }
 
-  memcpy(opaque, &mapping->instance, sizeof(mapping->instance));
+  mapping = DecodeAddress(bus, type, *address);
+  *cycles = mapping->cycles + mapping->contention;
+  memcpy(opaque, &mapping->readInstance, sizeof(mapping->readInstance));
   return mapping->onRead;
 }
 
@@ -294,16 +532,78 @@ MemoryFunction BusRead(const struct BusController *bus,
  *  BusReadWord: Read a word from a device using the bus.
  * ========================================================================= */
 uint32_t BusReadWord(const struct BusController *bus, uint32_t address) {
-  const struct MemoryMapping *mapping;
+  unsigned cycles;
+
+  return BusReadWordTimed(bus, address, &cycles);
+}
+
+/* ============================================================================
+ *  BusReadWordTimed: Like BusReadWord, but also returns the access cost.
+ * ========================================================================= */
+uint32_t BusReadWordTimed(const struct BusController *bus,
+  uint32_t address, unsigned *cycles) {
+  const struct MemoryMapping *mapping = DecodeAddress(bus, 2, address);
   uint32_t word;
 
-  if ((mapping = ResolveMappedAddress(bus->memoryMaps[2], address)) == NULL) {
-    debugarg("Read WORD from unmapped address [0x%.8x].", address);
-    return 0;
+  *cycles = mapping->cycles + mapping->contention;
+  mapping->onRead(mapping->readInstance, address, &word);
+  return word;
+}
+
+/* ============================================================================
+ *  BusReadWordVirtual: Read a word from a device using a virtual address.
+ *
+ *  Returns nonzero (without touching the bus) if the address can't be
+ *  translated, so that the caller can raise the appropriate exception.
+ * ========================================================================= */
+int BusReadWordVirtual(const struct BusController *bus,
+  uint64_t vaddr, uint32_t *word) {
+  unsigned cycles;
+
+  return BusReadWordVirtualTimed(bus, vaddr, word, &cycles);
+}
+
+/* ============================================================================
+ *  BusReadWordVirtualTimed: Like BusReadWordVirtual, but also returns the
+ *  cost of the access.
+ * ========================================================================= */
+int BusReadWordVirtualTimed(const struct BusController *bus,
+  uint64_t vaddr, uint32_t *word, unsigned *cycles) {
+  const struct MemoryMapping *mapping;
+  uint32_t address;
+
+  if (TranslateVirtualAddress(bus, vaddr, &address)) {
+    *cycles = 0;
+    return 1;
   }
 
-  mapping->onRead(mapping->instance, address, &word);
-  return word;
+  mapping = DecodeAddress(bus, 2, address);
+  *cycles = mapping->cycles + mapping->contention;
+  mapping->onRead(mapping->readInstance, address, word);
+  return 0;
+}
+
+/* ============================================================================
+ *  BusSetAccessCost: Sets the cost of accesses that decode near `address`.
+ *
+ *  Every width-specific mapping covering `address` is updated. `cycles` is
+ *  the base cost; `contention` is any extra stall charged on top of it.
+ * ========================================================================= */
+int
+BusSetAccessCost(struct BusController *bus,
+  uint32_t address, unsigned cycles, unsigned contention) {
+  struct MemoryMapping *mapping;
+  unsigned i, found = 0;
+
+  for (i = 0; i < 5; i++) {
+    if ((mapping = FindAddressMapping(bus->memoryMaps[i], address)) != NULL) {
+      mapping->cycles = cycles;
+      mapping->contention = contention;
+      found++;
+    }
+  }
+
+  return found == 0;
 }
 
 /* ============================================================================
@@ -311,15 +611,49 @@ uint32_t BusReadWord(const struct BusController *bus, uint32_t address) {
  * ========================================================================= */
 MemoryFunction BusWrite(const struct BusController *bus,
   unsigned type, uint32_t address, void **opaque) {
-  const struct MemoryMap *memoryMap = bus->memoryMaps[type];
+  unsigned cycles;
+
+  return BusWriteTimed(bus, type, address, opaque, &cycles);
+}
+
+/* ============================================================================
+ *  BusWriteTimed: Like BusWrite, but also returns the cost of the access.
+ * ========================================================================= */
+MemoryFunction BusWriteTimed(const struct BusController *bus,
+  unsigned type, uint32_t address, void **opaque, unsigned *cycles) {
+  const struct MemoryMapping *mapping = DecodeAddress(bus, type, address);
+
+  *cycles = mapping->cycles + mapping->contention;
+  memcpy(opaque, &mapping->writeInstance, sizeof(mapping->writeInstance));
+  return mapping->onWrite;
+}
+
+/* ============================================================================
+ *  BusWriteVirtual: Writes a variable amount of data using a virtual address.
+ * ========================================================================= */
+MemoryFunction BusWriteVirtual(const struct BusController *bus,
+  unsigned type, uint64_t vaddr, void **opaque, uint32_t *address) {
+  unsigned cycles;
+
+  return BusWriteVirtualTimed(bus, type, vaddr, opaque, address, &cycles);
+}
+
+/* ============================================================================
+ *  BusWriteVirtualTimed: Like BusWriteVirtual, but also returns the cost.
+ * ========================================================================= */
+MemoryFunction BusWriteVirtualTimed(const struct BusController *bus,
+  unsigned type, uint64_t vaddr, void **opaque, uint32_t *address,
+  unsigned *cycles) {
   const struct MemoryMapping *mapping;
 
-  if ((mapping = ResolveMappedAddress(memoryMap, address)) == NULL) {
-    debugarg("Write to unmapped address [0x%.8X].", address);
+  if (TranslateVirtualAddress(bus, vaddr, address)) {
+    *cycles = 0;
     return NULL;
   }
 
-  memcpy(opaque, &mapping->instance, sizeof(mapping->instance));
+  mapping = DecodeAddress(bus, type, *address);
+  *cycles = mapping->cycles + mapping->contention;
+  memcpy(opaque, &mapping->writeInstance, sizeof(mapping->writeInstance));
   return mapping->onWrite;
 }
 
@@ -328,13 +662,124 @@ MemoryFunction BusWrite(const struct BusController *bus,
  * ========================================================================= */
 void BusWriteWord(const struct BusController *bus,
   uint32_t address, uint32_t word) {
+  unsigned cycles;
+
+  BusWriteWordTimed(bus, address, word, &cycles);
+}
+
+/* ============================================================================
+ *  BusWriteWordTimed: Like BusWriteWord, but also returns the access cost.
+ * ========================================================================= */
+void BusWriteWordTimed(const struct BusController *bus,
+  uint32_t address, uint32_t word, unsigned *cycles) {
+  const struct MemoryMapping *mapping = DecodeAddress(bus, 2, address);
+
+  *cycles = mapping->cycles + mapping->contention;
+  mapping->onWrite(mapping->writeInstance, address, &word);
+}
+
+/* ============================================================================
+ *  BusWriteWordVirtual: Write a word to a device using a virtual address.
+ *
+ *  Returns nonzero (without touching the bus) if the address can't be
+ *  translated, so that the caller can raise the appropriate exception.
+ * ========================================================================= */
+int BusWriteWordVirtual(const struct BusController *bus,
+  uint64_t vaddr, uint32_t word) {
+  unsigned cycles;
+
+  return BusWriteWordVirtualTimed(bus, vaddr, word, &cycles);
+}
+
+/* ============================================================================
+ *  BusWriteWordVirtualTimed: Like BusWriteWordVirtual, but also returns the
+ *  cost of the access.
+ * ========================================================================= */
+int BusWriteWordVirtualTimed(const struct BusController *bus,
+  uint64_t vaddr, uint32_t word, unsigned *cycles) {
+  const struct MemoryMapping *mapping;
+  uint32_t address;
+
+  if (TranslateVirtualAddress(bus, vaddr, &address)) {
+    *cycles = 0;
+    return 1;
+  }
+
+  mapping = DecodeAddress(bus, 2, address);
+  *cycles = mapping->cycles + mapping->contention;
+  mapping->onWrite(mapping->writeInstance, address, &word);
+  return 0;
+}
+
+/* ============================================================================
+ *  BeginAccess: Per-access bookkeeping done ahead of decoding an address.
+ * ========================================================================= */
+static void
+BeginAccess(const struct BusController *bus, uint32_t address) {
+  if (unlikely(bus->writeBuffer != NULL))
+    SyncWriteBuffer(bus->writeBuffer, address);
+
+  if (unlikely(bus->telemetry != NULL))
+    CountBusAccess(bus->telemetry, address);
+}
+
+/* ============================================================================
+ *  CountMappedAccess: Feeds a successful decode to the decoder profile.
+ * ========================================================================= */
+static void
+CountMappedAccess(const struct BusController *bus,
+  unsigned type, const struct MemoryMapping *mapping) {
+  if (unlikely(bus->decoderProfile != NULL))
+    CountDecoderHit(bus->decoderProfile, type, mapping);
+}
+
+/* ============================================================================
+ *  CountUnmappedAccess: Records an access that didn't decode to anything.
+ * ========================================================================= */
+static void
+CountUnmappedAccess(const struct BusController *bus, uint32_t address) {
+  if (unlikely(bus->telemetry != NULL))
+    bus->telemetry->counters.unmappedAccesses++;
+
+  CountOpenBusAccess(bus->openBus, address);
+}
+
+/* ============================================================================
+ *  DecodeAddress: Resolves an address for an access of the given type.
+ *
+ *  Never fails: addresses that no device claims decode to open bus.
+ * ========================================================================= */
+static const struct MemoryMapping *
+DecodeAddress(const struct BusController *bus,
+  unsigned type, uint32_t address) {
+  const struct MemoryMap *map = bus->memoryMaps[type];
   const struct MemoryMapping *mapping;
 
-  if ((mapping = ResolveMappedAddress(bus->memoryMaps[2], address)) == NULL) {
-    debugarg("Write WORD to unmapped address [0x%.8x].", address);
-    return;
+  BeginAccess(bus, address);
+
+  if ((mapping = ResolveMappedAddress(map, address)) == NULL) {
+    CountUnmappedAccess(bus, address);
+    return bus->openBus->mappings + type;
   }
 
-  mapping->onWrite(mapping->instance, address, &word);
+  CountMappedAccess(bus, type, mapping);
+  return mapping;
 }
 
+/* ============================================================================
+ *  TranslateVirtualAddress: Converts a sign-extended virtual address.
+ *
+ *  KSEG0 and KSEG1 are contiguous and unmapped, so a single unsigned compare
+ *  catches both and translation is just a mask. Everything else is mapped
+ *  (or an error), so we defer to the VR4300's TLB in that case.
+ * ========================================================================= */
+static int
+TranslateVirtualAddress(const struct BusController *bus,
+  uint64_t vaddr, uint32_t *address) {
+  if (likely(vaddr - KSEG0_BASE_ADDRESS < 2 * KSEG_ADDRESS_LEN)) {
+    *address = (uint32_t) vaddr & KSEG_ADDRESS_MASK;
+    return 0;
+  }
+
+  return VR4300TranslateAddress(bus->vr4300, vaddr, address);
+}
@@ -13,12 +13,24 @@
 #include "Address.h"
 #include "Common.h"
 #include "MemoryMap.h"
+#include "SaveMemory.h"
+
+/* SP, SI, AI, VI, PI and DP interrupts (MI_INTR_REG bits). */
+#define RCP_INTERRUPT_MASK 0x3F
 
 struct AIFController;
+struct AudioRing;
+struct FrameExport;
+struct OpenBus;
 struct PIFController;
+struct BusTelemetry;
+struct DecoderProfile;
+struct DMAWorkers;
 struct RDRRAMController;
 struct ROMController;
 struct VIFController;
+struct WatchList;
+struct WriteBuffer;
 
 struct RDP;
 struct RSP;
@@ -35,6 +47,21 @@ struct BusController {
   struct VR4300 *vr4300;
 
   struct MemoryMap *memoryMaps[5];
+  struct WriteBuffer *writeBuffer;
+  struct FrameExport *frameExport;
+  struct AudioRing *audioRing;
+  struct SaveMemory saveMemory;
+  struct WatchList *watchList;
+  struct BusTelemetry *telemetry;
+  struct DMAWorkers *dmaWorkers;
+  struct DecoderProfile *decoderProfile;
+  struct OpenBus *openBus;
+
+  /* MI interrupt state; the VR4300 only hears about effective changes. */
+  unsigned rcpIntrPending;
+  unsigned rcpIntrMask;
+  unsigned rcpIntrNotified;
+  bool coalesceInterrupts;
 };
 
 struct BusController *CreateBus(
@@ -42,6 +69,62 @@ struct BusController *CreateBus(
   struct RDRAMController *, struct ROMController *,
   struct VIFController *, struct RDP *, struct RSP *,
   struct VR4300 *);
+void DestroyBus(struct BusController *);
+
+void BusClearRCPInterrupt(struct BusController *, unsigned);
+void BusRaiseRCPInterrupt(struct BusController *, unsigned);
+unsigned BusGetRCPInterruptPending(const struct BusController *);
+int BusMIRegRead(void *, uint32_t, void *);
+int BusMIRegWrite(void *, uint32_t, void *);
+void BusSetInterruptCoalescing(struct BusController *, bool);
+void BusSetRCPInterruptMask(struct BusController *, unsigned);
+void BusUpdateRCPInterrupt(struct BusController *);
+
+MemoryFunction BusRead(const struct BusController *,
+  unsigned, uint32_t, void **);
+uint32_t BusReadWord(const struct BusController *, uint32_t);
+MemoryFunction BusWrite(const struct BusController *,
+  unsigned, uint32_t, void **);
+void BusWriteWord(const struct BusController *, uint32_t, uint32_t);
+
+int BusSetAccessCost(struct BusController *, uint32_t, unsigned, unsigned);
+MemoryFunction BusReadTimed(const struct BusController *,
+  unsigned, uint32_t, void **, unsigned *);
+uint32_t BusReadWordTimed(const struct BusController *, uint32_t, unsigned *);
+MemoryFunction BusWriteTimed(const struct BusController *,
+  unsigned, uint32_t, void **, unsigned *);
+void BusWriteWordTimed(const struct BusController *,
+  uint32_t, uint32_t, unsigned *);
+
+const uint8_t *BusGetRDRAMPointer(const struct BusController *);
+void DMAFromDRAM(struct BusController *, void *, uint32_t, uint32_t);
+void DMAToDRAM(struct BusController *, uint32_t, const void *, size_t);
+
+MemoryFunction BusReadVirtual(const struct BusController *,
+  unsigned, uint64_t, void **, uint32_t *);
+int BusReadWordVirtual(const struct BusController *, uint64_t, uint32_t *);
+MemoryFunction BusWriteVirtual(const struct BusController *,
+  unsigned, uint64_t, void **, uint32_t *);
+int BusWriteWordVirtual(const struct BusController *, uint64_t, uint32_t);
+
+MemoryFunction BusReadVirtualTimed(const struct BusController *,
+  unsigned, uint64_t, void **, uint32_t *, unsigned *);
+int BusReadWordVirtualTimed(const struct BusController *,
+  uint64_t, uint32_t *, unsigned *);
+MemoryFunction BusWriteVirtualTimed(const struct BusController *,
+  unsigned, uint64_t, void **, uint32_t *, unsigned *);
+int BusWriteWordVirtualTimed(const struct BusController *,
+  uint64_t, uint32_t, unsigned *);
+
+/* ============================================================================
+ *  BusCheckRCPInterrupt: Instruction-boundary check for coalesced delivery.
+ * ========================================================================= */
+static inline void
+BusCheckRCPInterrupt(struct BusController *bus) {
+  if (unlikely((bus->rcpIntrPending & bus->rcpIntrMask) !=
+    bus->rcpIntrNotified))
+    BusUpdateRCPInterrupt(bus);
+}
 
 #endif
 
@@ -0,0 +1,364 @@
+/* ============================================================================
+ *  DMAEngine.c: Scatter-gather DMA with optional worker threads.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Common.h"
+#include "Controller.h"
+#include "DMAEngine.h"
+#include "Externs.h"
+#include "Telemetry.h"
+#include "WriteBuffer.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdlib>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static void CopyPiece(struct BusController *, enum BusDMADirection,
+  const struct BusDMASegment *, unsigned, unsigned);
+static void CopyRows(struct BusController *, enum BusDMADirection,
+  const struct BusDMASegment *, uint32_t, uint32_t, uint32_t, uint32_t);
+static void StreamFromDRAM(struct RDRAMController *,
+  uint8_t *, uint32_t, size_t);
+
+#ifndef _WIN32
+static void RunPieces(struct DMAWorkers *);
+static void *WorkerMain(void *);
+#endif
+
+/* ============================================================================
+ *  BusDisableDMAWorkers: Stops and joins all of the DMA worker threads.
+ * ========================================================================= */
+void
+BusDisableDMAWorkers(struct BusController *bus) {
+#ifndef _WIN32
+  struct DMAWorkers *workers = bus->dmaWorkers;
+  unsigned i;
+
+  if (workers == NULL)
+    return;
+
+  pthread_mutex_lock(&workers->lock);
+  workers->exiting = true;
+  pthread_cond_broadcast(&workers->wake);
+  pthread_mutex_unlock(&workers->lock);
+
+  for (i = 0; i < workers->numThreads; i++)
+    pthread_join(workers->threads[i], NULL);
+
+  pthread_cond_destroy(&workers->done);
+  pthread_cond_destroy(&workers->wake);
+  pthread_mutex_destroy(&workers->lock);
+
+  bus->dmaWorkers = NULL;
+  free(workers->threads);
+  free(workers);
+#else
+  (void) bus;
+#endif
+}
+
+/* ============================================================================
+ *  BusDMAScatterGather: Performs a list of (possibly strided) transfers.
+ *
+ *  Segments are performed in order. Small ones are copied in place; large
+ *  ones are cut into one piece per worker (plus one for the caller) and
+ *  copied concurrently. Pieces never overlap, so the only requirement is
+ *  that CopyFromDRAM/CopyToDRAM may run concurrently on disjoint ranges.
+ * ========================================================================= */
+void
+BusDMAScatterGather(struct BusController *bus,
+  enum BusDMADirection direction, const struct BusDMASegment *segments,
+  unsigned numSegments) {
+  struct DMAWorkers *workers = bus->dmaWorkers;
+  const struct BusDMASegment *segment;
+  size_t size;
+  unsigned i;
+
+  if (bus->writeBuffer != NULL)
+    FlushWriteBuffer(bus->writeBuffer);
+
+  for (i = 0; i < numSegments; i++) {
+    segment = &segments[i];
+    size = (size_t) segment->length * segment->count;
+
+    if (bus->telemetry != NULL)
+      bus->telemetry->counters.dmaBytes += size;
+
+    if (workers == NULL || size < DMA_PARALLEL_THRESHOLD) {
+      CopyPiece(bus, direction, segment, 0, 1);
+      continue;
+    }
+
+#ifndef _WIN32
+    pthread_mutex_lock(&workers->lock);
+    workers->direction = direction;
+    workers->segment = segment;
+    workers->numPieces = workers->numThreads + 1;
+    workers->piecesDone = 0;
+    atomic_write(&workers->nextPiece, 0);
+    workers->generation++;
+    pthread_cond_broadcast(&workers->wake);
+    pthread_mutex_unlock(&workers->lock);
+
+    RunPieces(workers);
+
+    pthread_mutex_lock(&workers->lock);
+    while (workers->piecesDone < workers->numPieces)
+      pthread_cond_wait(&workers->done, &workers->lock);
+    pthread_mutex_unlock(&workers->lock);
+#endif
+  }
+}
+
+/* ============================================================================
+ *  BusEnableDMAWorkers: Spins up `numThreads` threads for large transfers.
+ * ========================================================================= */
+int
+BusEnableDMAWorkers(struct BusController *bus, unsigned numThreads) {
+#ifndef _WIN32
+  struct DMAWorkers *workers;
+  unsigned i;
+
+  if (bus->dmaWorkers != NULL)
+    return 0;
+
+  if (numThreads == 0)
+    return 1;
+
+  if ((workers = (struct DMAWorkers*) calloc(1, sizeof(*workers))) == NULL) {
+    debug("Failed to allocate memory.");
+    return 1;
+  }
+
+  if ((workers->threads = (pthread_t*) calloc(
+    numThreads, sizeof(*workers->threads))) == NULL) {
+    debug("Failed to allocate memory.");
+    free(workers);
+    return 1;
+  }
+
+  workers->bus = bus;
+  pthread_mutex_init(&workers->lock, NULL);
+  pthread_cond_init(&workers->wake, NULL);
+  pthread_cond_init(&workers->done, NULL);
+
+  for (i = 0; i < numThreads; i++) {
+    if (pthread_create(&workers->threads[i], NULL, WorkerMain, workers)) {
+      debug("Failed to create a DMA worker.");
+      break;
+    }
+
+    workers->numThreads++;
+  }
+
+  /* Run with however many threads we got; if none, tear it all down. */
+  bus->dmaWorkers = workers;
+
+  if (workers->numThreads == 0) {
+    BusDisableDMAWorkers(bus);
+    return 1;
+  }
+
+  return 0;
+#else
+  (void) bus;
+  (void) numThreads;
+  return 1;
+#endif
+}
+
+/* ============================================================================
+ *  CopyPiece: Performs the `piece`th of `numPieces` parts of a segment.
+ *
+ *  Multi-row segments are split by rows; single-row segments are split into
+ *  (doubleword-aligned) byte ranges instead.
+ * ========================================================================= */
+static void
+CopyPiece(struct BusController *bus, enum BusDMADirection direction,
+  const struct BusDMASegment *segment, unsigned piece, unsigned numPieces) {
+  uint32_t first, last, per;
+
+  if (segment->count == 1) {
+    per = ((segment->length + numPieces - 1) / numPieces + 7) & ~7U;
+    first = piece * per < segment->length ? piece * per : segment->length;
+    last = first + per < segment->length ? first + per : segment->length;
+
+    if (first < last)
+      CopyRows(bus, direction, segment, 0, 1, first, last);
+  }
+
+  else {
+    per = (segment->count + numPieces - 1) / numPieces;
+    first = piece * per < segment->count ? piece * per : segment->count;
+    last = first + per < segment->count ? first + per : segment->count;
+
+    CopyRows(bus, direction, segment, first, last, 0, segment->length);
+  }
+}
+
+/* ============================================================================
+ *  CopyRows: Copies bytes [start, end) of rows [first, last) of a segment.
+ * ========================================================================= */
+static void
+CopyRows(struct BusController *bus, enum BusDMADirection direction,
+  const struct BusDMASegment *segment, uint32_t first, uint32_t last,
+  uint32_t start, uint32_t end) {
+  size_t size = (size_t) segment->length * segment->count;
+  uint32_t dramAddress;
+  uint8_t *buffer;
+
+  for (; first < last; first++) {
+    dramAddress = segment->dramAddress + first * segment->dramStride + start;
+    buffer = segment->buffer + first * segment->bufferStride + start;
+
+    if (direction == BUS_DMA_FROM_DRAM && size >= DMA_STREAM_THRESHOLD)
+      StreamFromDRAM(bus->rdram, buffer, dramAddress, end - start);
+    else if (direction == BUS_DMA_FROM_DRAM)
+      CopyFromDRAM(bus->rdram, buffer, dramAddress, end - start);
+    else
+      CopyToDRAM(bus->rdram, dramAddress, buffer, end - start);
+  }
+}
+
+/* ============================================================================
+ *  RestartDMAWorkers: Recreates the workers in a forked instance.
+ *
+ *  Only the forking thread survives fork(), and the pool's locks may have
+ *  been copied mid-use, so the old pool is abandoned rather than torn down.
+ * ========================================================================= */
+int
+RestartDMAWorkers(struct BusController *bus) {
+#ifndef _WIN32
+  struct DMAWorkers *workers = bus->dmaWorkers;
+  unsigned numThreads;
+
+  if (workers == NULL)
+    return 0;
+
+  numThreads = workers->numThreads;
+  bus->dmaWorkers = NULL;
+
+  free(workers->threads);
+  free(workers);
+
+  return BusEnableDMAWorkers(bus, numThreads);
+#else
+  (void) bus;
+  return 0;
+#endif
+}
+
+/* ============================================================================
+ *  StreamFromDRAM: Copies out of RDRAM without dragging the destination
+ *  through the host's caches.
+ *
+ *  Data is still pulled through CopyFromDRAM (so it's in the usual byte
+ *  order), but only a chunk at a time into a small bounce buffer that stays
+ *  in L1; from there it's written out with non-temporal stores.
+ *
+ *  There's no StreamToDRAM: the bus never writes RDRAM storage directly,
+ *  so large PI loads (cart to RDRAM) still go through plain CopyToDRAM.
+ * ========================================================================= */
+static void
+StreamFromDRAM(struct RDRAMController *rdram,
+  uint8_t *dest, uint32_t source, size_t size) {
+#ifdef __SSE2__
+  uint8_t bounce[DMA_STREAM_CHUNK] __attribute__((aligned(16)));
+  size_t chunk, i, head = -(uintptr_t) dest & 0xF;
+
+  if (head > size)
+    head = size;
+
+  if (head > 0) {
+    CopyFromDRAM(rdram, dest, source, head);
+    dest += head;
+    source += head;
+    size -= head;
+  }
+
+  while (size >= 16) {
+    chunk = size < sizeof(bounce) ? size & ~(size_t) 0xF : sizeof(bounce);
+    CopyFromDRAM(rdram, bounce, source, chunk);
+
+    for (i = 0; i < chunk; i += 16) {
+      _mm_stream_si128((__m128i*) (dest + i),
+        _mm_load_si128((const __m128i*) (bounce + i)));
+    }
+
+    dest += chunk;
+    source += chunk;
+    size -= chunk;
+  }
+
+  if (size > 0)
+    CopyFromDRAM(rdram, dest, source, size);
+
+  _mm_sfence();
+#else
+  CopyFromDRAM(rdram, dest, source, size);
+#endif
+}
+
+#ifndef _WIN32
+/* ============================================================================
+ *  RunPieces: Claims and copies pieces of the current segment until none
+ *  are left. Called by the workers and the thread that started the DMA.
+ * ========================================================================= */
+static void
+RunPieces(struct DMAWorkers *workers) {
+  unsigned piece;
+
+  while ((piece = atomic_inc(&workers->nextPiece) - 1) <
+    workers->numPieces) {
+    CopyPiece(workers->bus, workers->direction,
+      workers->segment, piece, workers->numPieces);
+
+    pthread_mutex_lock(&workers->lock);
+    if (++workers->piecesDone == workers->numPieces)
+      pthread_cond_signal(&workers->done);
+    pthread_mutex_unlock(&workers->lock);
+  }
+}
+
+/* ============================================================================
+ *  WorkerMain: Sleeps until a large segment shows up, then helps copy it.
+ * ========================================================================= */
+static void *
+WorkerMain(void *opaque) {
+  struct DMAWorkers *workers = (struct DMAWorkers*) opaque;
+  unsigned generation = 0;
+
+  pthread_mutex_lock(&workers->lock);
+
+  while (true) {
+    while (workers->generation == generation && !workers->exiting)
+      pthread_cond_wait(&workers->wake, &workers->lock);
+
+    if (workers->exiting)
+      break;
+
+    generation = workers->generation;
+    pthread_mutex_unlock(&workers->lock);
+    RunPieces(workers);
+    pthread_mutex_lock(&workers->lock);
+  }
+
+  pthread_mutex_unlock(&workers->lock);
+  return NULL;
+}
+#endif
+
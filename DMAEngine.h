@@ -0,0 +1,80 @@
+/* ============================================================================
+ *  DMAEngine.h: Scatter-gather DMA with optional worker threads.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__DMAENGINE_H__
+#define __BUS__DMAENGINE_H__
+#include "Common.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+/* Transfers at least this large get split across the workers. */
+#ifndef DMA_PARALLEL_THRESHOLD
+#define DMA_PARALLEL_THRESHOLD (256 * 1024)
+#endif
+
+/* Transfers out of RDRAM at least this large bypass the host's caches.
+ * Transfers into RDRAM (e.g., PI cart loads) never do: stores into RDRAM
+ * belong to CopyToDRAM, and the RDRAM controller offers no streaming path. */
+#ifndef DMA_STREAM_THRESHOLD
+#define DMA_STREAM_THRESHOLD (1024 * 1024)
+#endif
+
+#define DMA_STREAM_CHUNK (16 * 1024)
+
+struct BusController;
+
+enum BusDMADirection {
+  BUS_DMA_FROM_DRAM,
+  BUS_DMA_TO_DRAM
+};
+
+/* `count` rows of `length` bytes; strides are measured row to row. */
+struct BusDMASegment {
+  uint32_t dramAddress;
+  uint32_t dramStride;
+  uint8_t *buffer;
+  uint32_t bufferStride;
+
+  uint32_t length;
+  uint32_t count;
+};
+
+#ifndef _WIN32
+struct DMAWorkers {
+  struct BusController *bus;
+  pthread_t *threads;
+  unsigned numThreads;
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  unsigned generation;
+  bool exiting;
+
+  /* The segment currently being split up. */
+  enum BusDMADirection direction;
+  const struct BusDMASegment *segment;
+  unsigned numPieces;
+  unsigned nextPiece;
+  unsigned piecesDone;
+};
+#endif
+
+int BusEnableDMAWorkers(struct BusController *, unsigned);
+void BusDisableDMAWorkers(struct BusController *);
+int RestartDMAWorkers(struct BusController *);
+
+void BusDMAScatterGather(struct BusController *, enum BusDMADirection,
+  const struct BusDMASegment *, unsigned);
+
+#endif
+
@@ -0,0 +1,155 @@
+/* ============================================================================
+ *  DecoderProfile.c: Profile-guided address decoder layout.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Common.h"
+#include "Controller.h"
+#include "DecoderProfile.h"
+#include "MemoryMap.h"
+
+#ifdef __cplusplus
+#include <cstdio>
+#include <cstdlib>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+static int RebuildDecoders(struct BusController *);
+
+/* ============================================================================
+ *  BusEnableAdaptiveDecoding: Counts the next `warmup` decodes, then
+ *  rebuilds every memory map so that the busiest mappings resolve first.
+ * ========================================================================= */
+int
+BusEnableAdaptiveDecoding(struct BusController *bus, uint64_t warmup) {
+  struct DecoderProfile *profile;
+  struct MemoryMap *map;
+  unsigned i, j;
+
+  if (bus->decoderProfile != NULL)
+    return 0;
+
+  if (warmup == 0)
+    return 1;
+
+  if ((profile = (struct DecoderProfile*) malloc(sizeof(*profile))) == NULL) {
+    debug("Failed to allocate memory.");
+    return 1;
+  }
+
+  for (i = 0; i < 5; i++) {
+    map = bus->memoryMaps[i];
+
+    for (j = 0; j < map->nextMapIndex; j++)
+      map->mappings[j].weight = 0;
+  }
+
+  profile->bus = bus;
+  profile->remaining = warmup;
+  bus->decoderProfile = profile;
+  return 0;
+}
+
+/* ============================================================================
+ *  BusLoadDecoderLayout: Applies weights saved by BusSaveDecoderLayout.
+ *
+ *  Entries that don't match a mapping (e.g., from a different build) are
+ *  skipped, so a stale layout degrades to a balanced tree, never worse.
+ * ========================================================================= */
+int
+BusLoadDecoderLayout(struct BusController *bus, const char *path) {
+  unsigned long long weight;
+  struct MemoryMap *map;
+  unsigned long start;
+  unsigned i, type;
+  FILE *file;
+
+  if ((file = fopen(path, "r")) == NULL) {
+    debugarg("Failed to open decoder layout [%s].", path);
+    return 1;
+  }
+
+  while (fscanf(file, "%u %lx %llu", &type, &start, &weight) == 3) {
+    if (type >= 5)
+      continue;
+
+    map = bus->memoryMaps[type];
+
+    for (i = 0; i < map->nextMapIndex; i++) {
+      if (map->mappings[i].mapping.start == start) {
+        map->mappings[i].weight = weight;
+        break;
+      }
+    }
+  }
+
+  fclose(file);
+  return RebuildDecoders(bus);
+}
+
+/* ============================================================================
+ *  BusSaveDecoderLayout: Writes the mapping weights out for later runs.
+ * ========================================================================= */
+int
+BusSaveDecoderLayout(const struct BusController *bus, const char *path) {
+  const struct MemoryMap *map;
+  unsigned i, type;
+  FILE *file;
+
+  if ((file = fopen(path, "w")) == NULL) {
+    debugarg("Failed to open decoder layout [%s].", path);
+    return 1;
+  }
+
+  for (type = 0; type < 5; type++) {
+    map = bus->memoryMaps[type];
+
+    for (i = 0; i < map->nextMapIndex; i++) {
+      fprintf(file, "%u %.8lx %llu\n", type,
+        (unsigned long) map->mappings[i].mapping.start,
+        (unsigned long long) map->mappings[i].weight);
+    }
+  }
+
+  return fclose(file) != 0;
+}
+
+/* ============================================================================
+ *  CountDecoderHit: Records a decode; rebuilds once warm-up is over.
+ * ========================================================================= */
+void
+CountDecoderHit(struct DecoderProfile *profile,
+  unsigned type, const struct MemoryMapping *mapping) {
+  struct BusController *bus = profile->bus;
+
+  CountMappingHit(bus->memoryMaps[type], mapping);
+
+  if (--profile->remaining == 0) {
+    bus->decoderProfile = NULL;
+    free(profile);
+
+    RebuildDecoders(bus);
+  }
+}
+
+/* ============================================================================
+ *  RebuildDecoders: Relinks all of the memory maps by their weights.
+ * ========================================================================= */
+static int
+RebuildDecoders(struct BusController *bus) {
+  unsigned i;
+
+  for (i = 0; i < 5; i++)
+    if (RebuildMemoryMap(bus->memoryMaps[i]))
+      return 1;
+
+  return 0;
+}
+
@@ -0,0 +1,31 @@
+/* ============================================================================
+ *  DecoderProfile.h: Profile-guided address decoder layout.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__DECODERPROFILE_H__
+#define __BUS__DECODERPROFILE_H__
+#include "Common.h"
+#include "MemoryMap.h"
+
+struct BusController;
+
+struct DecoderProfile {
+  struct BusController *bus;
+  uint64_t remaining;
+};
+
+int BusEnableAdaptiveDecoding(struct BusController *, uint64_t);
+int BusLoadDecoderLayout(struct BusController *, const char *);
+int BusSaveDecoderLayout(const struct BusController *, const char *);
+
+void CountDecoderHit(struct DecoderProfile *,
+  unsigned, const struct MemoryMapping *);
+
+#endif
+
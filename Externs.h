@@ -11,6 +11,7 @@
 #ifndef __BUS__EXTERNS_H__
 #define __BUS__EXTERNS_H__
 #include "Controller.h"
+#include "FastBoot.h"
 
 #ifdef __cplusplus
 #include <cstddef>
@@ -93,7 +94,9 @@ void CopyToDRAM(struct RDRAMController *, uint32_t, const void *, size_t);
 
 const uint8_t *GetRDRAMMemoryPointer(const struct RDRAMController *);
 void VR4300ClearRCPInterrupt(struct VR4300 *, unsigned);
+void VR4300FastBoot(struct VR4300 *, const struct BusBootState *);
 void VR4300RaiseRCPInterrupt(struct VR4300 *, unsigned);
+int VR4300TranslateAddress(struct VR4300 *, uint64_t, uint32_t *);
 
 #endif
 
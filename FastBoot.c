@@ -0,0 +1,144 @@
+/* ============================================================================
+ *  FastBoot.c: High-level emulation of the PIF/IPL boot sequence.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Address.h"
+#include "Common.h"
+#include "Controller.h"
+#include "Externs.h"
+#include "FastBoot.h"
+
+#define IPL3_LENGTH     0x00001000
+#define IPL3_LOAD_LEN   0x00100000
+
+/* CIC variants, identified by the sum of the IPL3 words. */
+static const struct {
+  uint64_t checksum;
+  unsigned type;
+  unsigned seed;
+} CICTable[] = {
+  {0x000000D0027FDF31ULL, 6101, 0x3F},
+  {0x000000CFFB631223ULL, 6101, 0x3F},
+  {0x000000D057C85244ULL, 6102, 0x3F},
+  {0x000000D6497E414BULL, 6103, 0x78},
+  {0x0000011A49F60E96ULL, 6105, 0x91},
+  {0x000000D6D5BE5580ULL, 6106, 0x85},
+};
+
+static void LoadBootCode(struct BusController *, uint32_t);
+static void StoreWord(uint8_t *, uint32_t);
+
+/* ============================================================================
+ *  BusFastBoot: Puts the system in the state the IPL would leave it in.
+ *
+ *  Returns nonzero (without touching anything) if the CIC can't be
+ *  identified; the caller should fall back to running the PIF ROM then.
+ * ========================================================================= */
+int
+BusFastBoot(struct BusController *bus, struct BusBootState *state) {
+  uint64_t checksum = 0;
+  uint32_t header, word;
+  unsigned i;
+
+  for (i = 0x40; i < IPL3_LENGTH; i += 4)
+    checksum += BusReadWord(bus, ROM_CART_BASE_ADDRESS + i);
+
+  for (i = 0; i < sizeof(CICTable) / sizeof(*CICTable); i++)
+    if (CICTable[i].checksum == checksum)
+      break;
+
+  if (i == sizeof(CICTable) / sizeof(*CICTable)) {
+    debug("Unknown CIC; can't fast boot.");
+    return 1;
+  }
+
+  state->cicType = CICTable[i].type;
+  state->cicSeed = CICTable[i].seed;
+  state->entryPoint = BusReadWord(bus, ROM_CART_BASE_ADDRESS + 0x8);
+
+  if (state->cicType == 6103)
+    state->entryPoint -= 0x100000;
+  else if (state->cicType == 6106)
+    state->entryPoint -= 0x200000;
+
+  /* Country code lives in byte 0x3E of the header. */
+  switch (BusReadWord(bus, ROM_CART_BASE_ADDRESS + 0x3C) >> 8 & 0xFF) {
+    case 'D': case 'F': case 'I': case 'P':
+    case 'S': case 'U': case 'X': case 'Y':
+      state->tvType = TV_TYPE_PAL;
+      break;
+
+    case 'B':
+      state->tvType = TV_TYPE_MPAL;
+      break;
+
+    default:
+      state->tvType = TV_TYPE_NTSC;
+      break;
+  }
+
+  /* The PIF copies the header and IPL3 into DMEM... */
+  for (i = 0; i < IPL3_LENGTH; i += 4) {
+    word = BusReadWord(bus, ROM_CART_BASE_ADDRESS + i);
+    BusWriteWord(bus, RSP_DMEM_BASE_ADDRESS + i, word);
+  }
+
+  /* ... and IPL3 configures the PI from the header... */
+  header = BusReadWord(bus, ROM_CART_BASE_ADDRESS);
+  BusWriteWord(bus, PI_REGS_BASE_ADDRESS + 0x14, header & 0xFF);
+  BusWriteWord(bus, PI_REGS_BASE_ADDRESS + 0x18, header >> 8 & 0xFF);
+  BusWriteWord(bus, PI_REGS_BASE_ADDRESS + 0x1C, header >> 16 & 0x0F);
+  BusWriteWord(bus, PI_REGS_BASE_ADDRESS + 0x20, header >> 20 & 0x03);
+
+  /* ... brings up RDRAM... */
+  BusWriteWord(bus, RI_REGS_BASE_ADDRESS + 0x00, 0x0000000E);
+  BusWriteWord(bus, RI_REGS_BASE_ADDRESS + 0x04, 0x00000040);
+  BusWriteWord(bus, RI_REGS_BASE_ADDRESS + 0x0C, 0x00000014);
+  BusWriteWord(bus, RI_REGS_BASE_ADDRESS + 0x10, 0x00063634);
+  BusWriteWord(bus, state->cicType == 6105 ? 0x3F0 : 0x318,
+    RDRAM_ADDRESS_LEN);
+
+  /* ... leaves the RSP halted and all RCP interrupts masked... */
+  BusWriteWord(bus, SP_REGS_BASE_ADDRESS + 0x10, 0x00000002);
+  BusWriteWord(bus, MI_REGS_BASE_ADDRESS + 0x0C, 0x00000555);
+
+  /* ... and loads the first megabyte of the game before jumping to it. */
+  LoadBootCode(bus, state->entryPoint & KSEG_ADDRESS_MASK);
+  VR4300FastBoot(bus->vr4300, state);
+  return 0;
+}
+
+/* ============================================================================
+ *  LoadBootCode: Copies what IPL3 would've loaded from the cart into RDRAM.
+ * ========================================================================= */
+static void
+LoadBootCode(struct BusController *bus, uint32_t dest) {
+  uint8_t buffer[0x1000];
+  uint32_t source = ROM_CART_BASE_ADDRESS + IPL3_LENGTH;
+  unsigned i, j;
+
+  for (i = 0; i < IPL3_LOAD_LEN; i += sizeof(buffer)) {
+    for (j = 0; j < sizeof(buffer); j += 4)
+      StoreWord(buffer + j, BusReadWord(bus, source + i + j));
+
+    DMAToDRAM(bus, dest + i, buffer, sizeof(buffer));
+  }
+}
+
+/* ============================================================================
+ *  StoreWord: Stores a word in RDRAM (big-endian) byte order.
+ * ========================================================================= */
+static void
+StoreWord(uint8_t *dest, uint32_t word) {
+  dest[0] = word >> 24;
+  dest[1] = word >> 16;
+  dest[2] = word >> 8;
+  dest[3] = word;
+}
+
@@ -0,0 +1,34 @@
+/* ============================================================================
+ *  FastBoot.h: High-level emulation of the PIF/IPL boot sequence.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__FASTBOOT_H__
+#define __BUS__FASTBOOT_H__
+#include "Common.h"
+
+struct BusController;
+
+enum TVType {
+  TV_TYPE_PAL = 0,
+  TV_TYPE_NTSC = 1,
+  TV_TYPE_MPAL = 2
+};
+
+/* What the IPL would have left behind for the VR4300. */
+struct BusBootState {
+  uint32_t entryPoint;
+  unsigned cicSeed;
+  unsigned cicType;
+  enum TVType tvType;
+};
+
+int BusFastBoot(struct BusController *, struct BusBootState *);
+
+#endif
+
@@ -0,0 +1,223 @@
+/* ============================================================================
+ *  ForkServer.c: Warm-start instance cloning.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#define _POSIX_C_SOURCE 200809L
+#include "AudioRing.h"
+#include "Common.h"
+#include "Controller.h"
+#include "DMAEngine.h"
+#include "ForkServer.h"
+#include "FrameExport.h"
+#include "OpenBus.h"
+#include "SaveMemory.h"
+#include "Telemetry.h"
+#include "WriteBuffer.h"
+
+#ifdef __cplusplus
+#include <cstdlib>
+#else
+#include <stdlib.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* PIDs of the clones this server forked and hasn't reaped yet. */
+struct CloneList {
+  pid_t *pids;
+  size_t numPids;
+  size_t capacity;
+};
+
+static int ReapClones(struct BusController *, struct CloneList *, int);
+static int ReportClone(struct BusController *, int, pid_t, int);
+#endif
+
+/* ============================================================================
+ *  BusAfterFork: Fixes up the state that can't be shared with the parent.
+ *
+ *  Everything else (RDRAM, the cart image, the decoders) stays shared
+ *  copy-on-write. Host threads don't survive a fork, so anything that was
+ *  handed to a consumer thread is reset; save memory is detached from the
+ *  file so that clones can't clobber each other's (or the parent's) saves,
+ *  telemetry moves to a segment of the clone's own and the DMA workers are
+ *  started afresh.
+ * ========================================================================= */
+int
+BusAfterFork(struct BusController *bus) {
+  if (bus->writeBuffer != NULL) {
+    bus->writeBuffer->numWrites = 0;
+    bus->writeBuffer->numFlushes = 0;
+  }
+
+  if (bus->frameExport != NULL) {
+    bus->frameExport->latest = NULL;
+    bus->frameExport->slots[0].refs = 0;
+    bus->frameExport->slots[1].refs = 0;
+    bus->frameExport->numPublished = 0;
+    bus->frameExport->numDropped = 0;
+  }
+
+  if (bus->audioRing != NULL) {
+    bus->audioRing->head = 0;
+    bus->audioRing->tail = 0;
+    bus->audioRing->overrunBytes = 0;
+    bus->audioRing->underrunBytes = 0;
+  }
+
+  BusResetOpenBusHistogram(bus);
+
+  if (ReopenTelemetry(bus) || RestartDMAWorkers(bus))
+    return 1;
+
+  return PrivatizeSaveMemory(&bus->saveMemory);
+}
+
+/* ============================================================================
+ *  BusRunForkServer: Parks a booted instance and clones it on request.
+ *
+ *  Each 4-byte message on `controlFd` forks a child. The parent replies on
+ *  `statusFd` with the child's PID. If `waitForChild` is set, that is
+ *  followed by the clone's exit report once it finishes; otherwise, exit
+ *  reports for any clones that finished in the meantime follow each reply.
+ *  An exit report is a pair of 4-byte words: the PID, negated, and the
+ *  wait status. The child returns 0 and simply carries on emulating from
+ *  wherever the parent was parked. The parent only returns (with -1) once
+ *  the control channel is closed or something goes wrong.
+ *
+ *  Only clones forked here are ever waited on, so the embedding program's
+ *  own children are left alone. Clones still running when the server
+ *  returns are left to the caller to reap, but their telemetry segments
+ *  are unlinked on the way out (unless a clone was still in BusAfterFork
+ *  and hadn't created its segment yet).
+ * ========================================================================= */
+int
+BusRunForkServer(struct BusController *bus,
+  int controlFd, int statusFd, bool waitForChild) {
+#ifndef _WIN32
+  struct CloneList clones = {NULL, 0, 0};
+  int32_t message;
+  int status;
+  pid_t pid;
+
+  while (read(controlFd, &message, sizeof(message)) == sizeof(message)) {
+    if (clones.numPids == clones.capacity) {
+      size_t capacity = clones.capacity ? clones.capacity * 2 : 16;
+      pid_t *pids;
+
+      if ((pids = (pid_t*) realloc(clones.pids,
+        capacity * sizeof(*pids))) == NULL) {
+        debug("Failed to allocate memory.");
+        break;
+      }
+
+      clones.pids = pids;
+      clones.capacity = capacity;
+    }
+
+    if ((pid = fork()) < 0) {
+      debug("Failed to fork an instance.");
+      break;
+    }
+
+    if (pid == 0) {
+      free(clones.pids);
+      close(controlFd);
+      close(statusFd);
+
+      if (BusAfterFork(bus))
+        _exit(1);
+
+      return 0;
+    }
+
+    message = pid;
+    if (write(statusFd, &message, sizeof(message)) != sizeof(message))
+      break;
+
+    if (waitForChild) {
+      if (waitpid(pid, &status, 0) < 0 ||
+        ReportClone(bus, statusFd, pid, status))
+        break;
+    }
+
+    else {
+      clones.pids[clones.numPids++] = pid;
+
+      if (ReapClones(bus, &clones, statusFd))
+        break;
+    }
+  }
+
+  ReapClones(bus, &clones, statusFd);
+
+  /* Their segments stay mapped in the clones; only the names go away. */
+  while (clones.numPids > 0)
+    RemoveCloneTelemetry(bus, clones.pids[--clones.numPids]);
+
+  free(clones.pids);
+#else
+  (void) bus;
+  (void) controlFd;
+  (void) statusFd;
+  (void) waitForChild;
+#endif
+
+  return -1;
+}
+
+#ifndef _WIN32
+/* ============================================================================
+ *  ReapClones: Reports (and forgets) every tracked clone that has exited.
+ * ========================================================================= */
+static int
+ReapClones(struct BusController *bus,
+  struct CloneList *clones, int statusFd) {
+  size_t i = 0;
+  pid_t pid;
+  int status;
+
+  while (i < clones->numPids) {
+    pid = waitpid(clones->pids[i], &status, WNOHANG);
+
+    if (pid == 0) {
+      i++;
+      continue;
+    }
+
+    clones->pids[i] = clones->pids[--clones->numPids];
+
+    if (pid > 0 && ReportClone(bus, statusFd, pid, status))
+      return 1;
+  }
+
+  return 0;
+}
+
+/* ============================================================================
+ *  ReportClone: Cleans up after a reaped clone and sends its exit report.
+ * ========================================================================= */
+static int
+ReportClone(struct BusController *bus,
+  int statusFd, pid_t pid, int status) {
+  int32_t report[2];
+
+  /* The clone can't clean up after itself; it usually just _exit()s. */
+  RemoveCloneTelemetry(bus, pid);
+
+  report[0] = -pid;
+  report[1] = status;
+
+  return write(statusFd, report, sizeof(report)) != sizeof(report);
+}
+#endif
+
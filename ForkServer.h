@@ -0,0 +1,21 @@
+/* ============================================================================
+ *  ForkServer.h: Warm-start instance cloning.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__FORKSERVER_H__
+#define __BUS__FORKSERVER_H__
+#include "Common.h"
+
+struct BusController;
+
+int BusAfterFork(struct BusController *);
+int BusRunForkServer(struct BusController *, int, int, bool);
+
+#endif
+
@@ -0,0 +1,219 @@
+/* ============================================================================
+ *  FrameExport.c: Framebuffer export to host consumer threads.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Address.h"
+#include "Common.h"
+#include "Controller.h"
+#include "FrameExport.h"
+#include "MemoryMap.h"
+#include "Watchpoint.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+/* VI registers that describe the framebuffer. */
+enum VIRegister {
+  VI_STATUS_REG = 0,
+  VI_ORIGIN_REG = 1,
+  VI_WIDTH_REG = 2,
+  VI_V_START_REG = 10,
+  VI_Y_SCALE_REG = 13
+};
+
+static void PublishFrame(struct FrameExport *);
+
+/* ============================================================================
+ *  BusAcquireFrame: Takes a reference to the most recently published frame.
+ *
+ *  The reference is only kept if the slot is still the latest one after
+ *  we've bumped its count; otherwise the emulation thread may be in the
+ *  middle of refilling it, so back off and try again.
+ * ========================================================================= */
+const struct BusFrame *
+BusAcquireFrame(struct BusController *bus) {
+  struct FrameExport *exporter = bus->frameExport;
+  struct FrameSlot *slot;
+
+  if (exporter == NULL)
+    return NULL;
+
+  while ((slot = atomic_read(&exporter->latest)) != NULL) {
+    atomic_inc(&slot->refs);
+
+    if (atomic_read(&exporter->latest) == slot)
+      return &slot->frame;
+
+    atomic_dec(&slot->refs);
+  }
+
+  return NULL;
+}
+
+/* ============================================================================
+ *  BusDisableFrameExport: Stops snooping the VI. All frames must be released.
+ * ========================================================================= */
+void
+BusDisableFrameExport(struct BusController *bus) {
+  struct FrameExport *exporter = bus->frameExport;
+  struct MemoryMapping *mapping;
+
+  if (exporter == NULL)
+    return;
+
+  SuspendWatchpoints(bus);
+  mapping = FindAddressMapping(bus->memoryMaps[2], VI_REGS_BASE_ADDRESS);
+  mapping->writeInstance = exporter->viInstance;
+  mapping->onWrite = exporter->viWrite;
+  ResumeWatchpoints(bus);
+
+  debugarg("Frame export dropped %lu frames.",
+    (unsigned long) exporter->numDropped);
+
+  bus->frameExport = NULL;
+  free(exporter);
+}
+
+/* ============================================================================
+ *  BusEnableFrameExport: Starts publishing a frame on every VI origin write.
+ * ========================================================================= */
+int
+BusEnableFrameExport(struct BusController *bus) {
+  struct FrameExport *exporter;
+  struct MemoryMapping *mapping;
+
+  if (bus->frameExport != NULL)
+    return 0;
+
+  if ((mapping = FindAddressMapping(bus->memoryMaps[2],
+    VI_REGS_BASE_ADDRESS)) == NULL)
+    return 1;
+
+  if ((exporter = (struct FrameExport*) calloc(1, sizeof(*exporter))) == NULL) {
+    debug("Failed to allocate memory.");
+    return 1;
+  }
+
+  SuspendWatchpoints(bus);
+
+  exporter->bus = bus;
+  exporter->viInstance = mapping->writeInstance;
+  exporter->viWrite = mapping->onWrite;
+
+  mapping->writeInstance = exporter;
+  mapping->onWrite = FrameExportVIRegWrite;
+  ResumeWatchpoints(bus);
+
+  bus->frameExport = exporter;
+  return 0;
+}
+
+/* ============================================================================
+ *  BusReleaseFrame: Drops a reference obtained through BusAcquireFrame.
+ *
+ *  Returns false if the guest moved VI_ORIGIN on while the frame was held.
+ *  The guest may have started drawing over the pixels from then on, so
+ *  anything copied out of the frame must be thrown away in that case.
+ * ========================================================================= */
+bool
+BusReleaseFrame(struct BusController *bus, const struct BusFrame *frame) {
+  struct FrameSlot *slot = (struct FrameSlot*) frame;
+  bool intact;
+
+  /* The pixel loads must complete before we look at the sequence. */
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  intact = atomic_read(&bus->frameExport->sequence) == frame->sequence;
+
+  atomic_dec(&slot->refs);
+  return intact;
+}
+
+/* ============================================================================
+ *  FrameExportVIRegWrite: Forwards a VI register write and shadows it.
+ * ========================================================================= */
+int
+FrameExportVIRegWrite(void *opaque, uint32_t address, void *data) {
+  struct FrameExport *exporter = (struct FrameExport*) opaque;
+  unsigned reg = (address - VI_REGS_BASE_ADDRESS) >> 2;
+  int status;
+
+  status = exporter->viWrite(exporter->viInstance, address, data);
+  memcpy(exporter->viRegs + reg, data, sizeof(*exporter->viRegs));
+
+  /* A new origin means the guest just finished a frame. */
+  if (reg == VI_ORIGIN_REG)
+    PublishFrame(exporter);
+
+  return status;
+}
+
+/* ============================================================================
+ *  PublishFrame: Hands out a frame that points straight into RDRAM.
+ *
+ *  Nothing is copied on the emulation thread: consumers copy the pixels out
+ *  of RDRAM themselves and then check (via BusReleaseFrame) that the guest
+ *  hadn't moved on in the meantime. A held frame is never modified, so if
+ *  the consumer is still sitting on the other slot, the frame is dropped.
+ * ========================================================================= */
+static void
+PublishFrame(struct FrameExport *exporter) {
+  const uint32_t *viRegs = exporter->viRegs;
+  struct FrameSlot *slot;
+
+  uint32_t origin = viRegs[VI_ORIGIN_REG] & 0xFFFFFF;
+  unsigned width = viRegs[VI_WIDTH_REG] & 0xFFF;
+  unsigned vStart = (viRegs[VI_V_START_REG] >> 16) & 0x3FF;
+  unsigned vEnd = viRegs[VI_V_START_REG] & 0x3FF;
+  unsigned yScale = viRegs[VI_Y_SCALE_REG] & 0xFFF;
+  unsigned bytesPerPixel, height, sequence;
+  size_t size;
+
+  /* Whatever was displayed before is fair game for the guest from now on. */
+  sequence = exporter->sequence + 1;
+  atomic_write(&exporter->sequence, sequence);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  switch (viRegs[VI_STATUS_REG] & 0x3) {
+    case 2: bytesPerPixel = 2; break;
+    case 3: bytesPerPixel = 4; break;
+    default: bytesPerPixel = 0; break;
+  }
+
+  height = vEnd > vStart ? (((vEnd - vStart) >> 1) * yScale) >> 10 : 0;
+  size = (size_t) width * height * bytesPerPixel;
+
+  slot = (atomic_read(&exporter->latest) == &exporter->slots[0])
+    ? &exporter->slots[1] : &exporter->slots[0];
+
+  if (size == 0 || origin + size > RDRAM_ADDRESS_LEN ||
+    atomic_read(&slot->refs) != 0) {
+    atomic_write(&exporter->latest, (struct FrameSlot*) NULL);
+    exporter->numDropped += size != 0;
+    return;
+  }
+
+  slot->frame.data = BusGetRDRAMPointer(exporter->bus) + origin;
+  slot->frame.size = size;
+  slot->frame.origin = origin;
+  slot->frame.width = width;
+  slot->frame.height = height;
+  slot->frame.bytesPerPixel = bytesPerPixel;
+  slot->frame.sequence = sequence;
+
+  atomic_write(&exporter->latest, slot);
+  exporter->numPublished++;
+}
+
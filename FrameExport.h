@@ -0,0 +1,68 @@
+/* ============================================================================
+ *  FrameExport.h: Framebuffer export to host consumer threads.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__FRAMEEXPORT_H__
+#define __BUS__FRAMEEXPORT_H__
+#include "Address.h"
+#include "Common.h"
+#include "MemoryMap.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#else
+#include <stddef.h>
+#endif
+
+struct BusController;
+
+/* What a consumer gets handed; never modified while referenced. `data`
+ * points into live RDRAM, so copy the pixels out and then check the result
+ * of BusReleaseFrame before trusting the copy. */
+struct BusFrame {
+  const uint8_t *data;
+  size_t size;
+
+  uint32_t origin;
+  unsigned width;
+  unsigned height;
+  unsigned bytesPerPixel;
+  unsigned sequence;
+};
+
+struct FrameSlot {
+  struct BusFrame frame;
+  unsigned refs;
+};
+
+struct FrameExport {
+  struct BusController *bus;
+  struct FrameSlot slots[2];
+  struct FrameSlot *latest;
+
+  /* Shadow of the VI registers; updated as the guest writes them. */
+  uint32_t viRegs[VI_REGS_ADDRESS_LEN / 4];
+  void *viInstance;
+  MemoryFunction viWrite;
+
+  unsigned sequence;
+  uint64_t numPublished;
+  uint64_t numDropped;
+};
+
+int BusEnableFrameExport(struct BusController *);
+void BusDisableFrameExport(struct BusController *);
+
+const struct BusFrame *BusAcquireFrame(struct BusController *);
+bool BusReleaseFrame(struct BusController *, const struct BusFrame *);
+
+int FrameExportVIRegWrite(void *, uint32_t, void *);
+
+#endif
+
@@ -23,10 +23,64 @@
 #endif
 
 /* Internal functions used to maintain the state of the tree. */
+static struct MemoryMapNode *BuildWeightedTree(struct MemoryMap *,
+  struct MemoryMapNode **, unsigned, unsigned, struct MemoryMapNode *);
 static void MemoryMapFixup(struct MemoryMap *, struct MemoryMapNode *);
 static void RotateLeft(struct MemoryMap *, struct MemoryMapNode *);
 static void RotateRight(struct MemoryMap *, struct MemoryMapNode *);
 
+/* ============================================================================
+ *  BuildWeightedTree: Builds a subtree from sorted nodes [lo, hi).
+ *
+ *  The root is whichever node leaves the heavier side as light as possible,
+ *  so heavily weighted mappings float up towards the top of the tree.
+ * ========================================================================= */
+static struct MemoryMapNode *
+BuildWeightedTree(struct MemoryMap *map, struct MemoryMapNode **nodes,
+  unsigned lo, unsigned hi, struct MemoryMapNode *parent) {
+  uint64_t left = 0, total = 0, best = ~0ULL, heavier;
+  unsigned i, root = lo + (hi - lo) / 2;
+  struct MemoryMapNode *node;
+
+  if (lo >= hi)
+    return map->nil;
+
+  for (i = lo; i < hi; i++)
+    total += nodes[i]->weight;
+
+  if (total > 0) {
+    for (i = lo; i < hi; i++) {
+      heavier = total - left - nodes[i]->weight;
+      heavier = left > heavier ? left : heavier;
+
+      if (heavier < best) {
+        best = heavier;
+        root = i;
+      }
+
+      left += nodes[i]->weight;
+    }
+  }
+
+  node = nodes[root];
+  node->parent = parent;
+  node->color = MEMORYMAP_BLACK;
+  node->left = BuildWeightedTree(map, nodes, lo, root, node);
+  node->right = BuildWeightedTree(map, nodes, root + 1, hi, node);
+  return node;
+}
+
+/* ============================================================================
+ *  CountMappingHit: Adds one to the weight of a mapping.
+ * ========================================================================= */
+void
+CountMappingHit(struct MemoryMap *map, const struct MemoryMapping *mapping) {
+  const struct MemoryMapNode *node = (const struct MemoryMapNode*)
+    ((const char*) mapping - offsetof(struct MemoryMapNode, mapping));
+
+  map->mappings[node - map->mappings].weight++;
+}
+
 /* ============================================================================
  *  CreateMemoryMap: Creates a new MemoryMap.
  * ========================================================================= */
@@ -61,6 +115,14 @@ DestroyMemoryMap(struct MemoryMap *memoryMap) {
   free(memoryMap);
 }
 
+/* ============================================================================
+ *  FindAddressMapping: Returns a modifiable mapping for an address (or NULL).
+ * ========================================================================= */
+struct MemoryMapping*
+FindAddressMapping(struct MemoryMap *map, uint32_t address) {
+  return (struct MemoryMapping*) ResolveMappedAddress(map, address);
+}
+
 /* ============================================================================
  *  MemoryMapFixup: Rebalances the tree after `node` is inserted.
  * ========================================================================= */
@@ -169,7 +231,8 @@ MapAddressRange(struct MemoryMap *map, uint32_t start, uint32_t length,
   newNode->parent = cur;
 
 	/* Initialize the entry. */
-	mapping.instance = instance;
+	mapping.readInstance = instance;
+	mapping.writeInstance = instance;
 	mapping.onRead = onRead;
 	mapping.onWrite = onWrite;
 
@@ -177,6 +240,9 @@ MapAddressRange(struct MemoryMap *map, uint32_t start, uint32_t length,
 	mapping.length = length;
 	mapping.start = start;
 
+	mapping.cycles = 0;
+	mapping.contention = 0;
+
 	newNode->mapping = mapping;
 
 	/* Rebalance the tree. */
@@ -184,6 +250,39 @@ MapAddressRange(struct MemoryMap *map, uint32_t start, uint32_t length,
 	MemoryMapFixup(map, newNode);
 }
 
+/* ============================================================================
+ *  RebuildMemoryMap: Relinks the tree according to the mapping weights.
+ *
+ *  The result is an ordinary BST (every node is colored black), so lookups
+ *  work as before and later insertions still leave a valid search tree.
+ * ========================================================================= */
+int
+RebuildMemoryMap(struct MemoryMap *map) {
+  struct MemoryMapNode **nodes, *node;
+  unsigned i, j, count = map->nextMapIndex;
+
+  if (count == 0)
+    return 0;
+
+  if ((nodes = (struct MemoryMapNode**) malloc(
+    sizeof(*nodes) * count)) == NULL)
+    return 1;
+
+  /* Sort the nodes by address; there's only ever a handful. */
+  for (i = 0; i < count; i++) {
+    node = &map->mappings[i];
+
+    for (j = i; j > 0 && nodes[j - 1]->mapping.start > node->mapping.start; j--)
+      nodes[j] = nodes[j - 1];
+
+    nodes[j] = node;
+  }
+
+  map->root = BuildWeightedTree(map, nodes, 0, count, map->nil);
+  free(nodes);
+  return 0;
+}
+
 /* ============================================================================
  *  ResolveMappedAddress: Returns a pointer to mapped memory (or NULL).
  * ========================================================================= */
@@ -22,7 +22,8 @@ enum MemoryMapColor {
 };
 
 struct MemoryMapping {
-  void *instance;
+  void *readInstance;
+  void *writeInstance;
 
   MemoryFunction onRead;
   MemoryFunction onWrite;
@@ -30,6 +31,10 @@ struct MemoryMapping {
   uint32_t length;
   uint32_t start;
   uint32_t end;
+
+  /* Access cost (in cycles) reported alongside each decode. */
+  unsigned cycles;
+  unsigned contention;
 };
 
 struct MemoryMapNode {
@@ -39,6 +44,7 @@ struct MemoryMapNode {
 
 	struct MemoryMapping mapping;
   enum MemoryMapColor color;
+  uint64_t weight;
 };
 
 struct MemoryMap {
@@ -53,6 +59,10 @@ struct MemoryMap {
 struct MemoryMap* CreateMemoryMap(unsigned);
 void DestroyMemoryMap(struct MemoryMap *);
 
+struct MemoryMapping* FindAddressMapping(struct MemoryMap *, uint32_t);
+void CountMappingHit(struct MemoryMap *, const struct MemoryMapping *);
+int RebuildMemoryMap(struct MemoryMap *);
+
 void MapAddressRange(struct MemoryMap *, uint32_t,
 	uint32_t, void *, MemoryFunction, MemoryFunction);
 
@@ -0,0 +1,202 @@
+/* ============================================================================
+ *  OpenBus.c: Catch-all mapping for accesses that decode to nothing.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Common.h"
+#include "Controller.h"
+#include "MemoryMap.h"
+#include "OpenBus.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+static uint32_t OpenBusPattern(uint32_t);
+
+/* ============================================================================
+ *  BusGetOpenBusHistogram: Copies out up to `max` non-empty page buckets.
+ *
+ *  Returns the number of buckets copied. Hits on pages that didn't fit in
+ *  the table are only counted in aggregate (see `overflowHits`).
+ * ========================================================================= */
+unsigned
+BusGetOpenBusHistogram(const struct BusController *bus,
+  struct OpenBusPage *pages, unsigned max) {
+  const struct OpenBus *openBus = bus->openBus;
+  unsigned i, count = 0;
+
+  for (i = 0; i < OPEN_BUS_HISTOGRAM_SIZE && count < max; i++) {
+    if (openBus->pages[i].hits != 0)
+      pages[count++] = openBus->pages[i];
+  }
+
+  return count;
+}
+
+/* ============================================================================
+ *  BusResetOpenBusHistogram: Forgets all unmapped hits seen so far.
+ * ========================================================================= */
+void
+BusResetOpenBusHistogram(struct BusController *bus) {
+  memset(bus->openBus->pages, 0, sizeof(bus->openBus->pages));
+  bus->openBus->overflowHits = 0;
+}
+
+/* ============================================================================
+ *  CountOpenBusAccess: Bumps the histogram bucket for an address's page.
+ *
+ *  The table is open-addressed with linear probing; once it fills up, hits
+ *  on pages we haven't seen before land in the overflow counter.
+ * ========================================================================= */
+void
+CountOpenBusAccess(struct OpenBus *openBus, uint32_t address) {
+  uint32_t page = address >> OPEN_BUS_PAGE_SHIFT;
+  unsigned i, slot = (page * 0x9E3779B1U) >> 26;
+
+  for (i = 0; i < OPEN_BUS_HISTOGRAM_SIZE; i++) {
+    struct OpenBusPage *bucket = openBus->pages +
+      ((slot + i) & (OPEN_BUS_HISTOGRAM_SIZE - 1));
+
+    if (bucket->hits == 0)
+      bucket->page = page;
+
+    if (bucket->page == page) {
+      if (bucket->hits != UINT32_MAX)
+        bucket->hits++;
+
+      return;
+    }
+  }
+
+  openBus->overflowHits++;
+}
+
+/* ============================================================================
+ *  CreateOpenBus: Builds the catch-all mapping for each access width.
+ *
+ *  The unaligned-store map (type 3) is write-only, here as everywhere else,
+ *  so it's the one case where BusRead still hands back a NULL handler.
+ * ========================================================================= */
+struct OpenBus *
+CreateOpenBus(void) {
+  static const MemoryFunction readers[5] = {
+    OpenBusReadByte, OpenBusReadHWord, OpenBusReadWord,
+    NULL, OpenBusReadDWord
+  };
+
+  struct OpenBus *openBus;
+  unsigned i;
+
+  if ((openBus = (struct OpenBus*) calloc(1, sizeof(*openBus))) == NULL) {
+    debug("Failed to allocate memory.");
+    return NULL;
+  }
+
+  for (i = 0; i < 5; i++) {
+    struct MemoryMapping *mapping = openBus->mappings + i;
+
+    mapping->readInstance = openBus;
+    mapping->writeInstance = openBus;
+    mapping->onRead = readers[i];
+    mapping->onWrite = OpenBusWrite;
+    mapping->start = 0;
+    mapping->end = UINT32_MAX;
+    mapping->length = UINT32_MAX;
+  }
+
+  return openBus;
+}
+
+/* ============================================================================
+ *  DestroyOpenBus: Releases the catch-all mapping.
+ * ========================================================================= */
+void
+DestroyOpenBus(struct OpenBus *openBus) {
+  if (openBus == NULL)
+    return;
+
+  debugarg("Open bus overflowed its histogram %lu times.",
+    (unsigned long) openBus->overflowHits);
+
+  free(openBus);
+}
+
+/* ============================================================================
+ *  OpenBusPattern: What the bus floats to when nothing drives it.
+ *
+ *  With no device responding, the PI hands back the low half of the
+ *  address it latched, in both halves of the word.
+ * ========================================================================= */
+static uint32_t
+OpenBusPattern(uint32_t address) {
+  return (address & 0xFFFF) | (address << 16);
+}
+
+/* ============================================================================
+ *  OpenBusReadByte: Reads a byte from open bus.
+ * ========================================================================= */
+int
+OpenBusReadByte(void *unused(opaque), uint32_t address, void *data) {
+  uint32_t word = OpenBusPattern(address & ~0x3U);
+  uint8_t byte = word >> ((3 - (address & 0x3)) << 3);
+
+  memcpy(data, &byte, sizeof(byte));
+  return 0;
+}
+
+/* ============================================================================
+ *  OpenBusReadDWord: Reads a doubleword from open bus.
+ * ========================================================================= */
+int
+OpenBusReadDWord(void *unused(opaque), uint32_t address, void *data) {
+  uint64_t dword = (uint64_t) OpenBusPattern(address) << 32 |
+    OpenBusPattern(address + 4);
+
+  memcpy(data, &dword, sizeof(dword));
+  return 0;
+}
+
+/* ============================================================================
+ *  OpenBusReadHWord: Reads a halfword from open bus.
+ * ========================================================================= */
+int
+OpenBusReadHWord(void *unused(opaque), uint32_t address, void *data) {
+  uint32_t word = OpenBusPattern(address & ~0x3U);
+  uint16_t hword = word >> ((2 - (address & 0x2)) << 3);
+
+  memcpy(data, &hword, sizeof(hword));
+  return 0;
+}
+
+/* ============================================================================
+ *  OpenBusReadWord: Reads a word from open bus.
+ * ========================================================================= */
+int
+OpenBusReadWord(void *unused(opaque), uint32_t address, void *data) {
+  uint32_t word = OpenBusPattern(address);
+
+  memcpy(data, &word, sizeof(word));
+  return 0;
+}
+
+/* ============================================================================
+ *  OpenBusWrite: Writes to open bus go nowhere.
+ * ========================================================================= */
+int
+OpenBusWrite(void *unused(opaque),
+  uint32_t unused(address), void *unused(data)) {
+  return 0;
+}
+
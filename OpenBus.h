@@ -0,0 +1,48 @@
+/* ============================================================================
+ *  OpenBus.h: Catch-all mapping for accesses that decode to nothing.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__OPENBUS_H__
+#define __BUS__OPENBUS_H__
+#include "Common.h"
+#include "MemoryMap.h"
+
+#define OPEN_BUS_PAGE_SHIFT 16
+#define OPEN_BUS_HISTOGRAM_SIZE 64
+
+struct BusController;
+
+/* One histogram bucket; a bucket with no hits is free. */
+struct OpenBusPage {
+  uint32_t page;
+  uint32_t hits;
+};
+
+struct OpenBus {
+  struct MemoryMapping mappings[5];
+  struct OpenBusPage pages[OPEN_BUS_HISTOGRAM_SIZE];
+  uint64_t overflowHits;
+};
+
+struct OpenBus *CreateOpenBus(void);
+void DestroyOpenBus(struct OpenBus *);
+
+unsigned BusGetOpenBusHistogram(const struct BusController *,
+  struct OpenBusPage *, unsigned);
+void BusResetOpenBusHistogram(struct BusController *);
+void CountOpenBusAccess(struct OpenBus *, uint32_t);
+
+int OpenBusReadByte(void *, uint32_t, void *);
+int OpenBusReadDWord(void *, uint32_t, void *);
+int OpenBusReadHWord(void *, uint32_t, void *);
+int OpenBusReadWord(void *, uint32_t, void *);
+int OpenBusWrite(void *, uint32_t, void *);
+
+#endif
+
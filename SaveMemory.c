@@ -0,0 +1,259 @@
+/* ============================================================================
+ *  SaveMemory.c: Memory-mapped cartridge save storage.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#define _POSIX_C_SOURCE 200809L
+#include "Address.h"
+#include "Common.h"
+#include "Controller.h"
+#include "SaveMemory.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <string.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void MarkDirty(struct SaveMemory *, size_t, size_t);
+
+/* ============================================================================
+ *  BusAttachSaveMemory: Backs the save domain with `size` bytes of a file.
+ *
+ *  Only SRAM is supported; see SAVE_SRAM_MAX_SIZE.
+ *
+ *  The file is mapped shared, so anything the guest writes lands in the
+ *  page cache immediately and survives the emulator crashing; flushes only
+ *  decide when the kernel is asked to push it out to disk.
+ * ========================================================================= */
+int
+BusAttachSaveMemory(struct BusController *bus, const char *path, size_t size) {
+  struct SaveMemory *save = &bus->saveMemory;
+
+#ifndef _WIN32
+  struct stat st;
+  long pageSize;
+  void *data;
+  int fd;
+
+  BusDetachSaveMemory(bus);
+
+  if ((pageSize = sysconf(_SC_PAGESIZE)) <= 0 || size == 0 ||
+    size > (size_t) pageSize * 64 || size > SAVE_SRAM_MAX_SIZE)
+    return 1;
+
+  if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+    debugarg("Failed to open save file [%s].", path);
+    return 1;
+  }
+
+  if (fstat(fd, &st) || ((size_t) st.st_size < size && ftruncate(fd, size))) {
+    debugarg("Failed to size save file [%s].", path);
+    close(fd);
+    return 1;
+  }
+
+  data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (data == MAP_FAILED) {
+    debugarg("Failed to map save file [%s].", path);
+    close(fd);
+    return 1;
+  }
+
+  save->data = (uint8_t*) data;
+  save->fd = fd;
+  save->size = size;
+  save->pageSize = pageSize;
+  save->dirtyPages = 0;
+  return 0;
+#else
+  (void) save;
+  (void) path;
+  (void) size;
+  return 1;
+#endif
+}
+
+/* ============================================================================
+ *  BusDetachSaveMemory: Writes back and unmaps the save file (if any).
+ * ========================================================================= */
+void
+BusDetachSaveMemory(struct BusController *bus) {
+  struct SaveMemory *save = &bus->saveMemory;
+
+  if (save->data == NULL)
+    return;
+
+#ifndef _WIN32
+  msync(save->data, save->size, MS_SYNC);
+  munmap(save->data, save->size);
+  close(save->fd);
+#endif
+
+  save->data = NULL;
+  save->size = 0;
+  save->dirtyPages = 0;
+}
+
+/* ============================================================================
+ *  BusFlushSaveMemory: Schedules write-back of dirty pages. Never blocks.
+ *
+ *  Meant to be called at frame boundaries (or off a timer). Adjacent dirty
+ *  pages are coalesced so that each run costs a single msync.
+ * ========================================================================= */
+void
+BusFlushSaveMemory(struct BusController *bus) {
+  struct SaveMemory *save = &bus->saveMemory;
+  unsigned first, last;
+
+  if (save->dirtyPages == 0)
+    return;
+
+  for (first = 0; first < 64; first = last) {
+    if (!(save->dirtyPages & (1ULL << first))) {
+      last = first + 1;
+      continue;
+    }
+
+    for (last = first; last < 64 && (save->dirtyPages & (1ULL << last)); )
+      last++;
+
+#ifndef _WIN32
+    msync(save->data + first * save->pageSize,
+      (last - first) * save->pageSize, MS_ASYNC);
+#endif
+  }
+
+  save->dirtyPages = 0;
+  save->numFlushes++;
+}
+
+/* ============================================================================
+ *  CopyFromSaveMemory: Performs a (PI) DMA out of save memory.
+ * ========================================================================= */
+size_t
+CopyFromSaveMemory(struct BusController *bus,
+  void *dest, uint32_t source, size_t size) {
+  struct SaveMemory *save = &bus->saveMemory;
+  size_t offset = source - CART_SRAM_BASE_ADDRESS;
+
+  if (offset >= save->size)
+    return 0;
+
+  if (size > save->size - offset)
+    size = save->size - offset;
+
+  memcpy(dest, save->data + offset, size);
+  return size;
+}
+
+/* ============================================================================
+ *  CopyToSaveMemory: Performs a (PI) DMA into save memory.
+ * ========================================================================= */
+size_t
+CopyToSaveMemory(struct BusController *bus,
+  uint32_t dest, const void *source, size_t size) {
+  struct SaveMemory *save = &bus->saveMemory;
+  size_t offset = dest - CART_SRAM_BASE_ADDRESS;
+
+  if (offset >= save->size || size == 0)
+    return 0;
+
+  if (size > save->size - offset)
+    size = save->size - offset;
+
+  memcpy(save->data + offset, source, size);
+  MarkDirty(save, offset, size);
+  return size;
+}
+
+/* ============================================================================
+ *  MarkDirty: Flags the pages spanned by [offset, offset + size).
+ * ========================================================================= */
+static void
+MarkDirty(struct SaveMemory *save, size_t offset, size_t size) {
+  size_t first = offset / save->pageSize;
+  size_t last = (offset + size - 1) / save->pageSize;
+
+  for (; first <= last; first++)
+    save->dirtyPages |= 1ULL << first;
+}
+
+/* ============================================================================
+ *  PrivatizeSaveMemory: Detaches save memory from the file (copy-on-write).
+ *
+ *  Used by forked instances: they start from the parent's save contents,
+ *  but anything they write afterwards stays private to that process.
+ * ========================================================================= */
+int
+PrivatizeSaveMemory(struct SaveMemory *save) {
+  if (save->data == NULL)
+    return 0;
+
+#ifndef _WIN32
+  if (mmap(save->data, save->size, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_FIXED, save->fd, 0) == MAP_FAILED)
+    return 1;
+#endif
+
+  save->dirtyPages = 0;
+  return 0;
+}
+
+/* ============================================================================
+ *  SaveMemoryRead: Reads a word from save memory.
+ * ========================================================================= */
+int
+SaveMemoryRead(void *opaque, uint32_t address, void *data) {
+  struct SaveMemory *save = (struct SaveMemory*) opaque;
+  size_t offset = address - CART_SRAM_BASE_ADDRESS;
+  uint32_t word = 0;
+
+  if (offset + sizeof(word) <= save->size) {
+    word = (uint32_t) save->data[offset + 0] << 24 |
+      (uint32_t) save->data[offset + 1] << 16 |
+      (uint32_t) save->data[offset + 2] << 8 |
+      (uint32_t) save->data[offset + 3];
+  }
+
+  memcpy(data, &word, sizeof(word));
+  return 0;
+}
+
+/* ============================================================================
+ *  SaveMemoryWrite: Writes a word to save memory.
+ * ========================================================================= */
+int
+SaveMemoryWrite(void *opaque, uint32_t address, void *data) {
+  struct SaveMemory *save = (struct SaveMemory*) opaque;
+  size_t offset = address - CART_SRAM_BASE_ADDRESS;
+  uint32_t word;
+
+  if (offset + sizeof(word) > save->size)
+    return 0;
+
+  memcpy(&word, data, sizeof(word));
+  save->data[offset + 0] = word >> 24;
+  save->data[offset + 1] = word >> 16;
+  save->data[offset + 2] = word >> 8;
+  save->data[offset + 3] = word;
+
+  MarkDirty(save, offset, sizeof(word));
+  return 0;
+}
+
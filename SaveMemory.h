@@ -0,0 +1,50 @@
+/* ============================================================================
+ *  SaveMemory.h: Memory-mapped cartridge save storage.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__SAVEMEMORY_H__
+#define __BUS__SAVEMEMORY_H__
+#include "Common.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#else
+#include <stddef.h>
+#endif
+
+/* Largest (256Kbit) SRAM. FlashRAM has a command/status protocol of its
+ * own that this device doesn't model, so FlashRAM-sized saves are refused. */
+#define SAVE_SRAM_MAX_SIZE 0x8000
+
+struct BusController;
+
+struct SaveMemory {
+  uint8_t *data;
+  size_t size;
+  size_t pageSize;
+  int fd;
+
+  /* One bit per page written since the last flush. */
+  uint64_t dirtyPages;
+  uint64_t numFlushes;
+};
+
+int BusAttachSaveMemory(struct BusController *, const char *, size_t);
+void BusDetachSaveMemory(struct BusController *);
+void BusFlushSaveMemory(struct BusController *);
+int PrivatizeSaveMemory(struct SaveMemory *);
+
+size_t CopyFromSaveMemory(struct BusController *, void *, uint32_t, size_t);
+size_t CopyToSaveMemory(struct BusController *, uint32_t, const void *, size_t);
+
+int SaveMemoryRead(void *, uint32_t, void *);
+int SaveMemoryWrite(void *, uint32_t, void *);
+
+#endif
+
@@ -0,0 +1,273 @@
+/* ============================================================================
+ *  Telemetry.c: Per-frame bus statistics published via shared memory.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#define _POSIX_C_SOURCE 200809L
+#include "Address.h"
+#include "Common.h"
+#include "Controller.h"
+#include "Telemetry.h"
+
+#ifdef __cplusplus
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* Room a clone's ".<pid>" suffix may take up (a 32-bit PID, at most). */
+#define CLONE_SUFFIX_LEN 11
+
+static void CloneSegmentName(const struct BusTelemetry *,
+  long, char *, size_t);
+static int OpenSegment(struct BusTelemetry *, const char *);
+
+/* ============================================================================
+ *  BusDisableTelemetry: Unmaps and removes the shared segment.
+ * ========================================================================= */
+void
+BusDisableTelemetry(struct BusController *bus) {
+  struct BusTelemetry *telemetry = bus->telemetry;
+
+  if (telemetry == NULL)
+    return;
+
+#ifndef _WIN32
+  munmap(telemetry->header, telemetry->segmentSize);
+  shm_unlink(telemetry->name);
+#endif
+
+  bus->telemetry = NULL;
+  free(telemetry);
+}
+
+/* ============================================================================
+ *  BusEnableTelemetry: Creates shared segment `name` with room for a ring
+ *  of `numRecords` frames and starts counting bus activity.
+ * ========================================================================= */
+int
+BusEnableTelemetry(struct BusController *bus,
+  const char *name, unsigned numRecords) {
+  struct BusTelemetry *telemetry;
+
+  if (bus->telemetry != NULL)
+    return 0;
+
+  /* Reject names that a forked clone couldn't append its PID to. */
+  if (numRecords == 0 || strlen(name) + CLONE_SUFFIX_LEN >=
+    sizeof(telemetry->name))
+    return 1;
+
+  if ((telemetry = (struct BusTelemetry*) calloc(
+    1, sizeof(*telemetry))) == NULL) {
+    debug("Failed to allocate memory.");
+    return 1;
+  }
+
+  telemetry->numRecords = numRecords;
+
+  if (OpenSegment(telemetry, name)) {
+    free(telemetry);
+    return 1;
+  }
+
+  bus->telemetry = telemetry;
+  return 0;
+}
+
+/* ============================================================================
+ *  BusPublishTelemetry: Pushes this frame's counters out and resets them.
+ *
+ *  Each frame costs one cache line in the segment. The record's sequence
+ *  number doubles as a seqlock: readers discard a record whose sequence is
+ *  zero or changes while they copy it. The newest record is simply the one
+ *  with the largest sequence number.
+ * ========================================================================= */
+void
+BusPublishTelemetry(struct BusController *bus) {
+  struct BusTelemetry *telemetry = bus->telemetry;
+  struct BusTelemetryRecord *record;
+
+  if (telemetry == NULL)
+    return;
+
+  record = &telemetry->records[telemetry->sequence % telemetry->numRecords];
+
+  if (++telemetry->sequence == 0)
+    telemetry->sequence = 1;
+
+  atomic_write(&record->sequence, 0);
+
+  /* Keep the payload stores from becoming visible before the zero. */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(record->accesses, telemetry->counters.accesses,
+    sizeof(*record) - offsetof(struct BusTelemetryRecord, accesses));
+  atomic_write(&record->sequence, telemetry->sequence);
+
+  memset(&telemetry->counters, 0, sizeof(telemetry->counters));
+}
+
+/* ============================================================================
+ *  CloneSegmentName: Names the segment of the clone with PID `pid`.
+ * ========================================================================= */
+static void
+CloneSegmentName(const struct BusTelemetry *telemetry,
+  long pid, char *name, size_t size) {
+  snprintf(name, size, "%s.%ld", telemetry->name, pid);
+}
+
+/* ============================================================================
+ *  CountBusAccess: Bumps the counter for the region `address` falls into.
+ * ========================================================================= */
+void
+CountBusAccess(struct BusTelemetry *telemetry, uint32_t address) {
+  enum BusRegion region;
+
+  if (address < RDRAM_REGS_BASE_ADDRESS)
+    region = BUS_REGION_RDRAM;
+  else if (address < RSP_DMEM_BASE_ADDRESS)
+    region = BUS_REGION_RDRAM_REGS;
+  else if (address < DP_REGS_BASE_ADDRESS)
+    region = BUS_REGION_RSP;
+  else if (address < 0x05000000)
+    region = BUS_REGION_RCP_REGS;
+  else if (address < CART_SRAM_BASE_ADDRESS)
+    region = BUS_REGION_OTHER;
+  else if (address < ROM_CART_BASE_ADDRESS)
+    region = BUS_REGION_SAVE;
+  else if (address < PIF_ROM_BASE_ADDRESS)
+    region = BUS_REGION_CART;
+  else if (address < PIF_RAM_BASE_ADDRESS + PIF_RAM_ADDRESS_LEN)
+    region = BUS_REGION_PIF;
+  else
+    region = BUS_REGION_OTHER;
+
+  telemetry->counters.accesses[region]++;
+}
+
+/* ============================================================================
+ *  OpenSegment: Creates, sizes and maps a shared segment for `telemetry`.
+ * ========================================================================= */
+static int
+OpenSegment(struct BusTelemetry *telemetry, const char *name) {
+#ifndef _WIN32
+  struct BusTelemetryHeader *header;
+  size_t size;
+  void *segment;
+  int fd;
+
+  if (strlen(name) >= sizeof(telemetry->name))
+    return 1;
+
+  size = sizeof(*header) +
+    sizeof(*telemetry->records) * telemetry->numRecords;
+
+  if ((fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+    debugarg("Failed to create telemetry segment [%s].", name);
+    return 1;
+  }
+
+  if (ftruncate(fd, size)) {
+    debugarg("Failed to size telemetry segment [%s].", name);
+    shm_unlink(name);
+    close(fd);
+    return 1;
+  }
+
+  segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (segment == MAP_FAILED) {
+    debugarg("Failed to map telemetry segment [%s].", name);
+    shm_unlink(name);
+    return 1;
+  }
+
+  header = (struct BusTelemetryHeader*) segment;
+  header->magic = BUS_TELEMETRY_MAGIC;
+  header->version = BUS_TELEMETRY_VERSION;
+  header->numRecords = telemetry->numRecords;
+  header->recordSize = sizeof(*telemetry->records);
+  header->pid = getpid();
+
+  strcpy(telemetry->name, name);
+  telemetry->header = header;
+  telemetry->records = (struct BusTelemetryRecord*) (header + 1);
+  telemetry->segmentSize = size;
+  telemetry->sequence = 0;
+  return 0;
+#else
+  (void) telemetry;
+  (void) name;
+  return 1;
+#endif
+}
+
+/* ============================================================================
+ *  ReopenTelemetry: Gives a forked instance a segment of its own.
+ *
+ *  The child would otherwise publish into its parent's ring. The new
+ *  segment is named after the parent's, suffixed with the child's PID.
+ *  Clones usually die without tearing anything down, so it's the parent
+ *  that removes the segment (via RemoveCloneTelemetry) once it reaps them.
+ * ========================================================================= */
+int
+ReopenTelemetry(struct BusController *bus) {
+  struct BusTelemetry *telemetry = bus->telemetry;
+  char name[sizeof(telemetry->name) + 24];
+
+  if (telemetry == NULL)
+    return 0;
+
+#ifndef _WIN32
+  munmap(telemetry->header, telemetry->segmentSize);
+  CloneSegmentName(telemetry, (long) getpid(), name, sizeof(name));
+#else
+  name[0] = '\0';
+#endif
+
+  memset(&telemetry->counters, 0, sizeof(telemetry->counters));
+
+  if (OpenSegment(telemetry, name)) {
+    bus->telemetry = NULL;
+    free(telemetry);
+    return 1;
+  }
+
+  return 0;
+}
+
+/* ============================================================================
+ *  RemoveCloneTelemetry: Removes the segment of a clone that has exited.
+ * ========================================================================= */
+void
+RemoveCloneTelemetry(struct BusController *bus, long pid) {
+  struct BusTelemetry *telemetry = bus->telemetry;
+  char name[sizeof(telemetry->name) + 24];
+
+  if (telemetry == NULL)
+    return;
+
+  CloneSegmentName(telemetry, pid, name, sizeof(name));
+
+#ifndef _WIN32
+  shm_unlink(name);
+#endif
+}
+
@@ -0,0 +1,79 @@
+/* ============================================================================
+ *  Telemetry.h: Per-frame bus statistics published via shared memory.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__TELEMETRY_H__
+#define __BUS__TELEMETRY_H__
+#include "Common.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#else
+#include <stddef.h>
+#endif
+
+#define BUS_TELEMETRY_MAGIC   0x42555354
+#define BUS_TELEMETRY_VERSION 1
+
+struct BusController;
+
+enum BusRegion {
+  BUS_REGION_RDRAM,
+  BUS_REGION_RDRAM_REGS,
+  BUS_REGION_RSP,
+  BUS_REGION_RCP_REGS,
+  BUS_REGION_SAVE,
+  BUS_REGION_CART,
+  BUS_REGION_PIF,
+  BUS_REGION_OTHER,
+  NUM_BUS_REGIONS
+};
+
+/* Exactly one cache line; `sequence` is zero while being rewritten. */
+struct BusTelemetryRecord {
+  uint32_t sequence;
+  uint32_t accesses[NUM_BUS_REGIONS];
+  uint32_t dmaBytes;
+  uint32_t interruptsRaised;
+  uint32_t interruptsCleared;
+  uint32_t unmappedAccesses;
+  uint32_t reserved[3];
+};
+
+/* Start of the shared segment; the records follow it. */
+struct BusTelemetryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numRecords;
+  uint32_t recordSize;
+  uint32_t pid;
+  uint32_t reserved[11];
+};
+
+struct BusTelemetry {
+  struct BusTelemetryRecord counters;
+  struct BusTelemetryHeader *header;
+  struct BusTelemetryRecord *records;
+
+  size_t segmentSize;
+  unsigned numRecords;
+  uint32_t sequence;
+  char name[64];
+};
+
+int BusEnableTelemetry(struct BusController *, const char *, unsigned);
+void BusDisableTelemetry(struct BusController *);
+void BusPublishTelemetry(struct BusController *);
+
+void CountBusAccess(struct BusTelemetry *, uint32_t);
+int ReopenTelemetry(struct BusController *);
+void RemoveCloneTelemetry(struct BusController *, long);
+
+#endif
+
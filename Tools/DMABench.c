@@ -0,0 +1,171 @@
+/* ============================================================================
+ *  DMABench.c: Throughput of BusDMAScatterGather vs. a single memcpy.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#define _POSIX_C_SOURCE 200809L
+#include "Address.h"
+#include "Common.h"
+#include "Controller.h"
+#include "DMAEngine.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_BYTES (512 * 1024 * 1024)
+
+/* Host buffers rotate through more memory than any cache holds. */
+#define BENCH_BUFFER_SIZE (64 * 1024 * 1024)
+
+/* RDRAM stand-in: flat storage, so CopyFromDRAM is exactly one memcpy. */
+struct RDRAMController {
+  uint8_t memory[RDRAM_ADDRESS_LEN];
+};
+
+static double Now(void);
+static double RunDMA(struct BusController *,
+  enum BusDMADirection, uint8_t *, size_t);
+static double RunMemcpy(struct RDRAMController *,
+  enum BusDMADirection, uint8_t *, size_t);
+
+/* ============================================================================
+ *  CopyFromDRAM: Stub; performs a DMA from RDRAM to a dest.
+ * ========================================================================= */
+void
+CopyFromDRAM(struct RDRAMController *rdram,
+  void *dest, uint32_t source, size_t size) {
+  memcpy(dest, rdram->memory + source, size);
+}
+
+/* ============================================================================
+ *  CopyToDRAM: Stub; performs a DMA from a source to RDRAM.
+ * ========================================================================= */
+void
+CopyToDRAM(struct RDRAMController *rdram,
+  uint32_t dest, const void *source, size_t size) {
+  memcpy(rdram->memory + dest, source, size);
+}
+
+/* ============================================================================
+ *  main: Prints GB/s for each transfer size, direction and worker count.
+ * ========================================================================= */
+int
+main(int argc, const char *argv[]) {
+  static const size_t sizes[] = {
+    16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20, 8 << 20
+  };
+
+  unsigned maxWorkers = argc > 1 ? (unsigned) atoi(argv[1]) : 3;
+  struct RDRAMController *rdram;
+  struct BusController bus;
+  uint8_t *buffer;
+  unsigned i, d, w;
+
+  rdram = (struct RDRAMController*) calloc(1, sizeof(*rdram));
+  buffer = (uint8_t*) calloc(1, BENCH_BUFFER_SIZE);
+
+  if (rdram == NULL || buffer == NULL)
+    return 1;
+
+  /* Fault everything in up front so that no column pays for it. */
+  memset(rdram->memory, 0x55, sizeof(rdram->memory));
+  memset(buffer, 0xAA, BENCH_BUFFER_SIZE);
+
+  memset(&bus, 0, sizeof(bus));
+  bus.rdram = rdram;
+
+  printf("%-8s %-5s %10s", "size", "dir", "memcpy");
+  for (w = 0; w <= maxWorkers; w++)
+    printf("  %3u worker%s", w, w == 1 ? " " : "s");
+  printf("   (GB/s)\n");
+
+  for (i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+    for (d = 0; d < 2; d++) {
+      enum BusDMADirection direction = d == 0
+        ? BUS_DMA_FROM_DRAM : BUS_DMA_TO_DRAM;
+
+      printf("%-8lu %-5s %10.2f", (unsigned long) sizes[i] >> 10,
+        d == 0 ? "from" : "to", RunMemcpy(rdram, direction, buffer, sizes[i]));
+
+      for (w = 0; w <= maxWorkers; w++) {
+        if (w > 0 && BusEnableDMAWorkers(&bus, w))
+          return 1;
+
+        printf("  %11.2f", RunDMA(&bus, direction, buffer, sizes[i]));
+        BusDisableDMAWorkers(&bus);
+      }
+
+      printf("\n");
+    }
+  }
+
+  free(buffer);
+  free(rdram);
+  return 0;
+}
+
+/* ============================================================================
+ *  Now: Returns a monotonic timestamp in seconds.
+ * ========================================================================= */
+static double
+Now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ============================================================================
+ *  RunDMA: Moves BENCH_BYTES through BusDMAScatterGather, `size` at a time.
+ * ========================================================================= */
+static double
+RunDMA(struct BusController *bus,
+  enum BusDMADirection direction, uint8_t *buffer, size_t size) {
+  struct BusDMASegment segment;
+  size_t i, iterations = BENCH_BYTES / size;
+  double start;
+
+  memset(&segment, 0, sizeof(segment));
+  segment.length = size;
+  segment.count = 1;
+
+  start = Now();
+
+  for (i = 0; i < iterations; i++) {
+    segment.dramAddress = i % (RDRAM_ADDRESS_LEN / size) * size;
+    segment.buffer = buffer + i % (BENCH_BUFFER_SIZE / size) * size;
+    BusDMAScatterGather(bus, direction, &segment, 1);
+  }
+
+  return (double) BENCH_BYTES / (Now() - start) * 1e-9;
+}
+
+/* ============================================================================
+ *  RunMemcpy: Moves BENCH_BYTES with one memcpy per transfer (the baseline).
+ * ========================================================================= */
+static double
+RunMemcpy(struct RDRAMController *rdram,
+  enum BusDMADirection direction, uint8_t *buffer, size_t size) {
+  size_t i, iterations = BENCH_BYTES / size;
+  double start = Now();
+
+  for (i = 0; i < iterations; i++) {
+    uint8_t *memory = rdram->memory + i % (RDRAM_ADDRESS_LEN / size) * size;
+    uint8_t *host = buffer + i % (BENCH_BUFFER_SIZE / size) * size;
+
+    if (direction == BUS_DMA_FROM_DRAM)
+      memcpy(host, memory, size);
+    else
+      memcpy(memory, host, size);
+  }
+
+  return (double) BENCH_BYTES / (Now() - start) * 1e-9;
+}
+
@@ -0,0 +1,321 @@
+/* ============================================================================
+ *  Watchpoint.c: Memory watchpoints (via mapping handler swaps).
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Common.h"
+#include "Controller.h"
+#include "MemoryMap.h"
+#include "OpenBus.h"
+#include "Watchpoint.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+/* Access width (in bytes) of each of the bus' memory maps. */
+static const unsigned MapWidths[5] = {1, 2, 4, 4, 8};
+
+static void InstallHook(struct WatchHook *);
+static void NotifyWatchpoints(const struct WatchHook *,
+  uint32_t, const void *, unsigned);
+static void RemoveHook(struct WatchHook *);
+static int UpdateHook(struct WatchList *, struct MemoryMapping *, unsigned);
+static int UpdateHooks(struct BusController *);
+
+/* ============================================================================
+ *  BusAddWatchpoint: Watches [start, start + length) for reads and/or writes.
+ *
+ *  Only mappings that overlap a watchpoint get their handlers wrapped, so
+ *  accesses anywhere else don't pay anything for watchpoints existing.
+ * ========================================================================= */
+struct Watchpoint *
+BusAddWatchpoint(struct BusController *bus, uint32_t start, uint32_t length,
+  unsigned flags, WatchpointCallback callback, void *opaque) {
+  struct Watchpoint *watch;
+  struct WatchList *list;
+
+  if (length == 0)
+    return NULL;
+
+  if ((list = bus->watchList) == NULL) {
+    if ((list = (struct WatchList*) calloc(1, sizeof(*list))) == NULL) {
+      debug("Failed to allocate memory.");
+      return NULL;
+    }
+
+    bus->watchList = list;
+  }
+
+  if ((watch = (struct Watchpoint*) malloc(sizeof(*watch))) == NULL) {
+    debug("Failed to allocate memory.");
+    return NULL;
+  }
+
+  watch->start = start;
+  watch->end = start + length - 1;
+  watch->flags = flags;
+  watch->callback = callback;
+  watch->opaque = opaque;
+
+  watch->next = list->watchpoints;
+  list->watchpoints = watch;
+
+  if (UpdateHooks(bus)) {
+    BusRemoveWatchpoint(bus, watch);
+    return NULL;
+  }
+
+  return watch;
+}
+
+/* ============================================================================
+ *  BusClearWatchpoints: Removes all watchpoints and restores every handler.
+ * ========================================================================= */
+void
+BusClearWatchpoints(struct BusController *bus) {
+  struct WatchList *list = bus->watchList;
+  struct Watchpoint *watch;
+
+  if (list == NULL)
+    return;
+
+  while ((watch = list->watchpoints) != NULL) {
+    list->watchpoints = watch->next;
+    free(watch);
+  }
+
+  UpdateHooks(bus);
+  bus->watchList = NULL;
+  free(list);
+}
+
+/* ============================================================================
+ *  BusRemoveWatchpoint: Removes a watchpoint (and any hooks it needed).
+ * ========================================================================= */
+void
+BusRemoveWatchpoint(struct BusController *bus, struct Watchpoint *watch) {
+  struct WatchList *list = bus->watchList;
+  struct Watchpoint **link;
+
+  if (list == NULL)
+    return;
+
+  for (link = &list->watchpoints; *link != NULL; link = &(*link)->next) {
+    if (*link == watch) {
+      *link = watch->next;
+      free(watch);
+      UpdateHooks(bus);
+      return;
+    }
+  }
+}
+
+/* ============================================================================
+ *  InstallHook: Puts the watch handlers in front of the mapping's own.
+ * ========================================================================= */
+static void
+InstallHook(struct WatchHook *hook) {
+  struct MemoryMapping *mapping = hook->mapping;
+
+  hook->readInstance = mapping->readInstance;
+  hook->writeInstance = mapping->writeInstance;
+  hook->onRead = mapping->onRead;
+  hook->onWrite = mapping->onWrite;
+
+  mapping->readInstance = hook;
+  mapping->writeInstance = hook;
+
+  if (mapping->onRead != NULL)
+    mapping->onRead = WatchpointRead;
+
+  if (mapping->onWrite != NULL)
+    mapping->onWrite = WatchpointWrite;
+}
+
+/* ============================================================================
+ *  NotifyWatchpoints: Fires the callbacks of watchpoints an access touched.
+ * ========================================================================= */
+static void
+NotifyWatchpoints(const struct WatchHook *hook,
+  uint32_t address, const void *data, unsigned direction) {
+  const struct Watchpoint *watch;
+  uint64_t value = 0;
+
+  uint8_t byte;
+  uint16_t hword;
+  uint32_t word;
+
+  switch (hook->width) {
+    case 1: memcpy(&byte, data, sizeof(byte)); value = byte; break;
+    case 2: memcpy(&hword, data, sizeof(hword)); value = hword; break;
+    case 4: memcpy(&word, data, sizeof(word)); value = word; break;
+    case 8: memcpy(&value, data, sizeof(value)); break;
+  }
+
+  for (watch = hook->list->watchpoints; watch != NULL; watch = watch->next) {
+    if ((watch->flags & direction) && address <= watch->end &&
+      address + hook->width - 1 >= watch->start) {
+      watch->callback(watch->opaque, address, hook->width,
+        value, direction == WATCH_WRITE);
+    }
+  }
+}
+
+/* ============================================================================
+ *  RemoveHook: Hands the mapping back its own handlers.
+ * ========================================================================= */
+static void
+RemoveHook(struct WatchHook *hook) {
+  struct MemoryMapping *mapping = hook->mapping;
+
+  mapping->readInstance = hook->readInstance;
+  mapping->writeInstance = hook->writeInstance;
+  mapping->onRead = hook->onRead;
+  mapping->onWrite = hook->onWrite;
+}
+
+/* ============================================================================
+ *  ResumeWatchpoints: Reinstalls hooks on top of whatever is mapped now.
+ * ========================================================================= */
+void
+ResumeWatchpoints(struct BusController *bus) {
+  struct WatchHook *hook;
+
+  if (bus->watchList == NULL)
+    return;
+
+  for (hook = bus->watchList->hooks; hook != NULL; hook = hook->next)
+    InstallHook(hook);
+}
+
+/* ============================================================================
+ *  SuspendWatchpoints: Pulls the hooks out so the handlers can be swapped.
+ *
+ *  Anything else that wraps handlers (write buffer, frame export) does so
+ *  between a suspend/resume pair, so watch hooks always stay outermost.
+ * ========================================================================= */
+void
+SuspendWatchpoints(struct BusController *bus) {
+  struct WatchHook *hook;
+
+  if (bus->watchList == NULL)
+    return;
+
+  for (hook = bus->watchList->hooks; hook != NULL; hook = hook->next)
+    RemoveHook(hook);
+}
+
+/* ============================================================================
+ *  UpdateHook: Hooks or unhooks one mapping, depending on whether any
+ *  watchpoint overlaps it.
+ * ========================================================================= */
+static int
+UpdateHook(struct WatchList *list,
+  struct MemoryMapping *mapping, unsigned width) {
+  const struct Watchpoint *watch;
+  struct WatchHook *hook, **link;
+  bool needed;
+
+  for (needed = false, watch = list->watchpoints; watch != NULL;
+    watch = watch->next) {
+    if (watch->start <= mapping->end && watch->end >= mapping->start) {
+      needed = true;
+      break;
+    }
+  }
+
+  for (link = &list->hooks; *link != NULL; link = &(*link)->next)
+    if ((*link)->mapping == mapping)
+      break;
+
+  if (needed && *link == NULL) {
+    if ((hook = (struct WatchHook*) calloc(1, sizeof(*hook))) == NULL) {
+      debug("Failed to allocate memory.");
+      return 1;
+    }
+
+    hook->list = list;
+    hook->mapping = mapping;
+    hook->width = width;
+    InstallHook(hook);
+
+    hook->next = list->hooks;
+    list->hooks = hook;
+  }
+
+  else if (!needed && *link != NULL) {
+    hook = *link;
+    *link = hook->next;
+
+    RemoveHook(hook);
+    free(hook);
+  }
+
+  return 0;
+}
+
+/* ============================================================================
+ *  UpdateHooks: Hooks exactly the mappings overlapped by some watchpoint.
+ *
+ *  Open bus counts as a mapping of its own (spanning everything), so that
+ *  watchpoints also fire on addresses that nothing else decodes.
+ * ========================================================================= */
+static int
+UpdateHooks(struct BusController *bus) {
+  struct WatchList *list = bus->watchList;
+  struct MemoryMap *map;
+  unsigned i, j;
+
+  for (i = 0; i < 5; i++) {
+    map = bus->memoryMaps[i];
+
+    for (j = 0; j < map->nextMapIndex; j++) {
+      if (UpdateHook(list, &map->mappings[j].mapping, MapWidths[i]))
+        return 1;
+    }
+
+    if (UpdateHook(list, bus->openBus->mappings + i, MapWidths[i]))
+      return 1;
+  }
+
+  return 0;
+}
+
+/* ============================================================================
+ *  WatchpointRead: Performs a read, then reports it.
+ * ========================================================================= */
+int
+WatchpointRead(void *opaque, uint32_t address, void *data) {
+  struct WatchHook *hook = (struct WatchHook*) opaque;
+  int status;
+
+  status = hook->onRead(hook->readInstance, address, data);
+  NotifyWatchpoints(hook, address, data, WATCH_READ);
+  return status;
+}
+
+/* ============================================================================
+ *  WatchpointWrite: Performs a write, then reports it.
+ * ========================================================================= */
+int
+WatchpointWrite(void *opaque, uint32_t address, void *data) {
+  struct WatchHook *hook = (struct WatchHook*) opaque;
+  int status;
+
+  status = hook->onWrite(hook->writeInstance, address, data);
+  NotifyWatchpoints(hook, address, data, WATCH_WRITE);
+  return status;
+}
+
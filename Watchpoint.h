@@ -0,0 +1,62 @@
+/* ============================================================================
+ *  Watchpoint.h: Memory watchpoints (via mapping handler swaps).
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__WATCHPOINT_H__
+#define __BUS__WATCHPOINT_H__
+#include "Common.h"
+#include "MemoryMap.h"
+
+#define WATCH_READ  0x1
+#define WATCH_WRITE 0x2
+
+struct BusController;
+
+typedef void (*WatchpointCallback)(void *,
+  uint32_t, unsigned, uint64_t, bool);
+
+struct Watchpoint {
+  struct Watchpoint *next;
+  uint32_t start;
+  uint32_t end;
+  unsigned flags;
+
+  WatchpointCallback callback;
+  void *opaque;
+};
+
+/* Sits in front of the original handlers of one watched mapping. */
+struct WatchHook {
+  struct WatchHook *next;
+  struct WatchList *list;
+  struct MemoryMapping *mapping;
+  unsigned width;
+
+  void *readInstance, *writeInstance;
+  MemoryFunction onRead, onWrite;
+};
+
+struct WatchList {
+  struct Watchpoint *watchpoints;
+  struct WatchHook *hooks;
+};
+
+struct Watchpoint *BusAddWatchpoint(struct BusController *, uint32_t,
+  uint32_t, unsigned, WatchpointCallback, void *);
+void BusRemoveWatchpoint(struct BusController *, struct Watchpoint *);
+void BusClearWatchpoints(struct BusController *);
+
+void SuspendWatchpoints(struct BusController *);
+void ResumeWatchpoints(struct BusController *);
+
+int WatchpointRead(void *, uint32_t, void *);
+int WatchpointWrite(void *, uint32_t, void *);
+
+#endif
+
@@ -0,0 +1,193 @@
+/* ============================================================================
+ *  WriteBuffer.c: Store-coalescing RDRAM write buffer.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#include "Address.h"
+#include "Common.h"
+#include "Controller.h"
+#include "Externs.h"
+#include "MemoryMap.h"
+#include "Watchpoint.h"
+#include "WriteBuffer.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#else
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#endif
+
+static void BufferWrite(struct WriteBuffer *, uint32_t, uint64_t, unsigned);
+
+/* ============================================================================
+ *  BufferWrite: Appends `size` bytes of `value` (in RDRAM byte order).
+ * ========================================================================= */
+static void
+BufferWrite(struct WriteBuffer *buffer,
+  uint32_t address, uint64_t value, unsigned size) {
+  unsigned i;
+
+  /* Only strictly sequential stores are combined. */
+  if (address != buffer->start + buffer->length ||
+    buffer->length + size > sizeof(buffer->data)) {
+    FlushWriteBuffer(buffer);
+    buffer->start = address;
+  }
+
+  for (i = 0; i < size; i++)
+    buffer->data[buffer->length + i] = value >> ((size - i - 1) << 3);
+
+  buffer->length += size;
+  buffer->numWrites++;
+}
+
+/* ============================================================================
+ *  BusDisableWriteCombining: Drains the buffer and restores RDRAM handlers.
+ * ========================================================================= */
+void
+BusDisableWriteCombining(struct BusController *bus) {
+  struct WriteBuffer *buffer = bus->writeBuffer;
+  struct MemoryMapping *mapping;
+
+  if (buffer == NULL)
+    return;
+
+  FlushWriteBuffer(buffer);
+  debugarg("Write buffer coalesced %.2f stores per flush.",
+    BusGetWriteCombiningRatio(bus));
+
+  SuspendWatchpoints(bus);
+  mapping = FindAddressMapping(bus->memoryMaps[2], RDRAM_BASE_ADDRESS);
+  mapping->writeInstance = buffer->wordInstance;
+  mapping->onWrite = buffer->wordWrite;
+
+  mapping = FindAddressMapping(bus->memoryMaps[4], RDRAM_BASE_ADDRESS);
+  mapping->writeInstance = buffer->dwordInstance;
+  mapping->onWrite = buffer->dwordWrite;
+  ResumeWatchpoints(bus);
+
+  bus->writeBuffer = NULL;
+  free(buffer);
+}
+
+/* ============================================================================
+ *  BusEnableWriteCombining: Routes RDRAM word/dword stores into a buffer.
+ * ========================================================================= */
+int
+BusEnableWriteCombining(struct BusController *bus) {
+  struct MemoryMapping *wordMapping, *dwordMapping;
+  struct WriteBuffer *buffer;
+
+  if (bus->writeBuffer != NULL)
+    return 0;
+
+  wordMapping = FindAddressMapping(bus->memoryMaps[2], RDRAM_BASE_ADDRESS);
+  dwordMapping = FindAddressMapping(bus->memoryMaps[4], RDRAM_BASE_ADDRESS);
+
+  if (wordMapping == NULL || dwordMapping == NULL)
+    return 1;
+
+  if ((buffer = (struct WriteBuffer*) calloc(1, sizeof(*buffer))) == NULL) {
+    debug("Failed to allocate memory.");
+    return 1;
+  }
+
+  SuspendWatchpoints(bus);
+
+  buffer->bus = bus;
+  buffer->wordInstance = wordMapping->writeInstance;
+  buffer->wordWrite = wordMapping->onWrite;
+  buffer->dwordInstance = dwordMapping->writeInstance;
+  buffer->dwordWrite = dwordMapping->onWrite;
+
+  wordMapping->writeInstance = buffer;
+  wordMapping->onWrite = WriteBufferWriteWord;
+  dwordMapping->writeInstance = buffer;
+  dwordMapping->onWrite = WriteBufferWriteDWord;
+  ResumeWatchpoints(bus);
+
+  bus->writeBuffer = buffer;
+  return 0;
+}
+
+/* ============================================================================
+ *  BusGetWriteCombiningRatio: Returns the average number of stores/flush.
+ * ========================================================================= */
+double
+BusGetWriteCombiningRatio(const struct BusController *bus) {
+  const struct WriteBuffer *buffer = bus->writeBuffer;
+
+  if (buffer == NULL || buffer->numFlushes == 0)
+    return 0.0;
+
+  return (double) buffer->numWrites / buffer->numFlushes;
+}
+
+/* ============================================================================
+ *  FlushWriteBuffer: Commits any pending stores to RDRAM as one block.
+ *
+ *  The buffer holds data in the same (big-endian) order that DMA sources
+ *  use, so the whole run can go through CopyToDRAM in one shot.
+ * ========================================================================= */
+void
+FlushWriteBuffer(struct WriteBuffer *buffer) {
+  if (buffer->length == 0)
+    return;
+
+  CopyToDRAM(buffer->bus->rdram, buffer->start, buffer->data, buffer->length);
+  buffer->numFlushes++;
+  buffer->length = 0;
+}
+
+/* ============================================================================
+ *  SyncWriteBuffer: Drains the buffer if an access could observe it.
+ *
+ *  Anything outside of RDRAM is treated as MMIO (which may kick off DMA or
+ *  otherwise have side effects), so we drain before those unconditionally.
+ * ========================================================================= */
+void
+SyncWriteBuffer(struct WriteBuffer *buffer, uint32_t address) {
+  if (buffer->length == 0)
+    return;
+
+  if (address >= RDRAM_BASE_ADDRESS + RDRAM_ADDRESS_LEN ||
+    (address + 8 > buffer->start &&
+    address < buffer->start + buffer->length))
+    FlushWriteBuffer(buffer);
+}
+
+/* ============================================================================
+ *  WriteBufferWriteDWord: Buffers a doubleword store to RDRAM.
+ * ========================================================================= */
+int
+WriteBufferWriteDWord(void *opaque, uint32_t address, void *data) {
+  struct WriteBuffer *buffer = (struct WriteBuffer*) opaque;
+  uint64_t dword;
+
+  memcpy(&dword, data, sizeof(dword));
+  BufferWrite(buffer, address, dword, sizeof(dword));
+  return 0;
+}
+
+/* ============================================================================
+ *  WriteBufferWriteWord: Buffers a word store to RDRAM.
+ * ========================================================================= */
+int
+WriteBufferWriteWord(void *opaque, uint32_t address, void *data) {
+  struct WriteBuffer *buffer = (struct WriteBuffer*) opaque;
+  uint32_t word;
+
+  memcpy(&word, data, sizeof(word));
+  BufferWrite(buffer, address, word, sizeof(word));
+  return 0;
+}
+
@@ -0,0 +1,46 @@
+/* ============================================================================
+ *  WriteBuffer.h: Store-coalescing RDRAM write buffer.
+ *
+ *  BusSIM: Reality Co-Processor Bus SIMulator.
+ *  Copyright (C) 2013, Tyler J. Stachecki.
+ *  All rights reserved.
+ *
+ *  This file is subject to the terms and conditions defined in
+ *  file 'LICENSE', which is part of this source code package.
+ * ========================================================================= */
+#ifndef __BUS__WRITEBUFFER_H__
+#define __BUS__WRITEBUFFER_H__
+#include "Common.h"
+#include "MemoryMap.h"
+
+#define WRITE_BUFFER_SIZE 512
+
+struct BusController;
+
+struct WriteBuffer {
+  struct BusController *bus;
+  uint8_t data[WRITE_BUFFER_SIZE];
+
+  uint32_t start;
+  uint32_t length;
+
+  /* Handlers that were displaced from the RDRAM mappings. */
+  void *wordInstance, *dwordInstance;
+  MemoryFunction wordWrite, dwordWrite;
+
+  uint64_t numWrites;
+  uint64_t numFlushes;
+};
+
+int BusEnableWriteCombining(struct BusController *);
+void BusDisableWriteCombining(struct BusController *);
+double BusGetWriteCombiningRatio(const struct BusController *);
+
+void FlushWriteBuffer(struct WriteBuffer *);
+void SyncWriteBuffer(struct WriteBuffer *, uint32_t);
+
+int WriteBufferWriteDWord(void *, uint32_t, void *);
+int WriteBufferWriteWord(void *, uint32_t, void *);
+
+#endif
+